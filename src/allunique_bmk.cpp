@@ -1,196 +1,334 @@
 #include <benchmark/benchmark.h>
 
 #include <algorithm>
-#include <array>
-#include <boost/sort/spreadsort/spreadsort.hpp>
-#include <iostream>
+#include <cstdio>
+#include <errno.h>
+#include <numeric>
 #include <random>
+#include <stdlib.h>
+#include <string>
+#include <system_error>
+#include <unistd.h>
 #include <vector>
 
+#include "perf_counters.h"
+#include "radix_sort_columns.h"
+#include "radix_sort_external.h"
 #include "radix_sort_hybrid.h"
-#include "radix_sort_lsd.h"
-#include "radix_sort_msd.h"
-
-#define TEST_SIZE DenseRange(10000, 600000, 50000)
-
-#define BMKBODY(SORT)                                                \
-    {                                                                \
-        const auto n = state.range(0);                               \
-        std::vector<T> values(m_vals.size());                        \
-        for (auto _ : state) {                                       \
-            std::copy(m_vals.begin(), m_vals.end(), values.begin()); \
-            SORT(values.begin(), values.end());                      \
-            benchmark::DoNotOptimize(values);                        \
-            benchmark::ClobberMemory();                              \
-        }                                                            \
-    }
+#include "sort_registry.h"
+
 using T = uint64_t;
 
-class SortingBmk_allUnique : public benchmark::Fixture {
+// Nullable columns, see radix_nulls.h
+
+// {n, percentage of nulls}
+#define NULL_SWEEP ArgsProduct({ { 100000, 1000000 }, { 0, 10, 25, 50, 75, 90 } })->ArgNames({ "n", "nulls" })
+
+/// uniform random 64-bit keys, range(1) percent of them null
+///
+class SortingBmk_nullable : public benchmark::Fixture {
 public:
     std::vector<T> m_vals;
+    std::vector<uint8_t> m_validity;
 
     void SetUp(const ::benchmark::State& state)
     {
         const auto n = state.range(0);
+        const auto nullPercent = state.range(1);
         m_vals.resize(n);
-        std::iota(m_vals.begin(), m_vals.end(), 0);
+        m_validity.assign((n + 7) / 8, 0);
 
-        std::random_device rd;
-        std::mt19937 g(rd());
-        std::shuffle(m_vals.begin(), m_vals.end(), g);
+        std::default_random_engine generator;
+        std::uniform_int_distribution<T> distribution;
+        std::uniform_int_distribution<int> percent(0, 99);
+
+        for (int i = 0; i < n; ++i) {
+            m_vals[i] = distribution(generator);
+            set_validity(m_validity.data(), i, i + 1, percent(generator) >= nullPercent);
+        }
     }
 
     void TearDown(const ::benchmark::State& state) { }
 };
 
-// We are interested in stable sort because it is currently used
-BENCHMARK_DEFINE_F(SortingBmk_allUnique, StdStableSort)
-(benchmark::State& state)
-{
-    BMKBODY(std::stable_sort);
-}
-BENCHMARK_REGISTER_F(SortingBmk_allUnique, StdStableSort)->Unit(benchmark::kMicrosecond)->TEST_SIZE;
-
-BENCHMARK_DEFINE_F(SortingBmk_allUnique, BoostSpreadSort)
-(benchmark::State& state)
-{
-    BMKBODY(boost::sort::spreadsort::spreadsort);
-}
-BENCHMARK_REGISTER_F(SortingBmk_allUnique, BoostSpreadSort)->Unit(benchmark::kMicrosecond)->TEST_SIZE;
-
-BENCHMARK_DEFINE_F(SortingBmk_allUnique, MSDRadixSort)
+// what the callers did before: compact out the nulls, sort, put them back at the start
+BENCHMARK_DEFINE_F(SortingBmk_nullable, CompactSortReinsert)
 (benchmark::State& state)
 {
     const auto n = state.range(0);
 
-    std::vector<uint64_t> values(m_vals.size());
+    std::vector<T> values(m_vals.size()), compacted(m_vals.size());
+    std::vector<uint8_t> validity(m_validity.size());
+    perf_counters::scope measure(state, state.range(0));
     for (auto _ : state) {
         std::copy(m_vals.begin(), m_vals.end(), values.begin());
+        std::copy(m_validity.begin(), m_validity.end(), validity.begin());
 
-        radix_sort_msd(values);
+        size_t valid = 0;
+        for (size_t i = 0; i < values.size(); ++i) {
+            if (is_valid(validity.data(), i))
+                compacted[valid++] = values[i];
+        }
+        radix_sort_hybrid(&compacted[0], valid);
+        const size_t nullCount = values.size() - valid;
+        std::copy(compacted.begin(), compacted.begin() + valid, values.begin() + nullCount);
+        set_validity(validity.data(), 0, nullCount, false);
+        set_validity(validity.data(), nullCount, values.size(), true);
         benchmark::DoNotOptimize(values);
+        benchmark::DoNotOptimize(validity);
         benchmark::ClobberMemory();
     }
 }
-BENCHMARK_REGISTER_F(SortingBmk_allUnique, MSDRadixSort)->Unit(benchmark::kMicrosecond)->TEST_SIZE;
+BENCHMARK_REGISTER_F(SortingBmk_nullable, CompactSortReinsert)->Unit(benchmark::kMicrosecond)->NULL_SWEEP;
 
-BENCHMARK_DEFINE_F(SortingBmk_allUnique, HybridRadixSort)
+BENCHMARK_DEFINE_F(SortingBmk_nullable, HybridRadixSort)
 (benchmark::State& state)
 {
     const auto n = state.range(0);
 
-    std::vector<uint64_t> values(m_vals.size());
+    std::vector<T> values(m_vals.size());
+    std::vector<uint8_t> validity(m_validity.size());
+    perf_counters::scope measure(state, state.range(0));
     for (auto _ : state) {
         std::copy(m_vals.begin(), m_vals.end(), values.begin());
+        std::copy(m_validity.begin(), m_validity.end(), validity.begin());
 
-        radix_sort_hybrid(values);
+        radix_sort_hybrid(&values[0], values.size(), validity.data(), null_placement::at_start);
         benchmark::DoNotOptimize(values);
+        benchmark::DoNotOptimize(validity);
         benchmark::ClobberMemory();
     }
 }
-BENCHMARK_REGISTER_F(SortingBmk_allUnique, HybridRadixSort)->Unit(benchmark::kMicrosecond)->TEST_SIZE;
+BENCHMARK_REGISTER_F(SortingBmk_nullable, HybridRadixSort)->Unit(benchmark::kMicrosecond)->NULL_SWEEP;
 
-BENCHMARK_DEFINE_F(SortingBmk_allUnique, LSDRadixSort)
+BENCHMARK_DEFINE_F(SortingBmk_nullable, HybridRadixArgsort)
 (benchmark::State& state)
 {
     const auto n = state.range(0);
 
-    std::vector<uint64_t> values(m_vals.size());
+    std::vector<uint32_t> indices(m_vals.size());
+    argsort_scratch<T> scratch;
+    perf_counters::scope measure(state, state.range(0));
     for (auto _ : state) {
-        std::copy(m_vals.begin(), m_vals.end(), values.begin());
-
-        radix_sort_lsd_travis(&values[0], values.size());
-        benchmark::DoNotOptimize(values);
+        radix_argsort_hybrid(m_vals.data(), m_vals.size(), m_validity.data(), null_placement::at_end, indices.data(), scratch);
+        benchmark::DoNotOptimize(indices);
         benchmark::ClobberMemory();
     }
 }
-BENCHMARK_REGISTER_F(SortingBmk_allUnique, LSDRadixSort)->Unit(benchmark::kMicrosecond)->TEST_SIZE;
+BENCHMARK_REGISTER_F(SortingBmk_nullable, HybridRadixArgsort)->Unit(benchmark::kMicrosecond)->NULL_SWEEP;
+
+// ORDER BY of several columns, see radix_sort_columns.h
 
-/// uniform random numbers in the range [0, 1e9]
+// {n, key columns, distinct values per column}
+#define COLUMNS_SWEEP ArgsProduct({ { 1000000 }, { 2, 3, 4 }, { 16, 1024, 1 << 20 } })->ArgNames({ "n", "columns", "cardinality" })
+
+/// range(1) columns of uniform random 64-bit keys with range(2) distinct values each
 ///
-class SortingBmk_uniform_1B : public benchmark::Fixture {
+class SortingBmk_columns : public benchmark::Fixture {
 public:
-    std::vector<T> m_vals;
+    std::vector<std::vector<T>> m_table;
+    std::vector<sort_column> m_columns;
 
     void SetUp(const ::benchmark::State& state)
     {
         const auto n = state.range(0);
-        m_vals.resize(n);
+        m_table.assign(state.range(1), std::vector<T>(n));
+        m_columns.clear();
 
         std::default_random_engine generator;
-        std::uniform_int_distribution<T> distribution(0, 1e9);
+        std::uniform_int_distribution<T> distribution(0, state.range(2) - 1);
 
-        for (int i = 0; i < n; ++i) {
-            m_vals[i] = distribution(generator);
+        for (auto& column : m_table) {
+            for (int i = 0; i < n; ++i) {
+                column[i] = distribution(generator);
+            }
+            m_columns.emplace_back(column.data());
         }
     }
 
     void TearDown(const ::benchmark::State& state) { }
 };
 
-// We are interested in stable sort because it is currently used
-BENCHMARK_DEFINE_F(SortingBmk_uniform_1B, StdStableSort)
+BENCHMARK_DEFINE_F(SortingBmk_columns, StdStableSortIndices)
 (benchmark::State& state)
 {
-    BMKBODY(std::stable_sort);
-}
-BENCHMARK_REGISTER_F(SortingBmk_uniform_1B, StdStableSort)->Unit(benchmark::kMicrosecond)->TEST_SIZE;
+    const auto n = state.range(0);
 
-BENCHMARK_DEFINE_F(SortingBmk_uniform_1B, BoostSpreadSort)
-(benchmark::State& state)
-{
-    BMKBODY(boost::sort::spreadsort::spreadsort);
+    std::vector<uint32_t> indices(n);
+    perf_counters::scope measure(state, state.range(0));
+    for (auto _ : state) {
+        std::iota(indices.begin(), indices.end(), 0);
+        std::stable_sort(indices.begin(), indices.end(), [this](uint32_t l, uint32_t r) {
+            for (const auto& column : m_table) {
+                if (column[l] != column[r])
+                    return column[l] < column[r];
+            }
+            return false;
+        });
+        benchmark::DoNotOptimize(indices);
+        benchmark::ClobberMemory();
+    }
 }
-BENCHMARK_REGISTER_F(SortingBmk_uniform_1B, BoostSpreadSort)->Unit(benchmark::kMicrosecond)->TEST_SIZE;
+BENCHMARK_REGISTER_F(SortingBmk_columns, StdStableSortIndices)->Unit(benchmark::kMillisecond)->COLUMNS_SWEEP;
 
-BENCHMARK_DEFINE_F(SortingBmk_uniform_1B, LSDRadixSort)
+// one stable argsort per column, from the last one to the first
+BENCHMARK_DEFINE_F(SortingBmk_columns, ChainedRadixArgsort)
 (benchmark::State& state)
 {
-    // it is custom due to buffer
     const auto n = state.range(0);
 
-    std::vector<T> values(m_vals.size());
+    std::vector<uint32_t> indices(n), order, permuted(n);
+    std::vector<T> keys(n);
+    argsort_scratch<T> scratch;
+    perf_counters::scope measure(state, state.range(0));
     for (auto _ : state) {
-        std::copy(m_vals.begin(), m_vals.end(), values.begin());
-
-        radix_sort_lsd_travis(&values.front(), values.size());
-        benchmark::DoNotOptimize(values);
+        std::iota(indices.begin(), indices.end(), 0);
+        for (size_t c = m_table.size(); c-- > 0;) {
+            for (int i = 0; i < n; ++i)
+                keys[i] = m_table[c][indices[i]];
+            radix_argsort_hybrid(keys, order, scratch);
+            for (int i = 0; i < n; ++i)
+                permuted[i] = indices[order[i]];
+            indices.swap(permuted);
+        }
+        benchmark::DoNotOptimize(indices);
         benchmark::ClobberMemory();
     }
 }
-BENCHMARK_REGISTER_F(SortingBmk_uniform_1B, LSDRadixSort)->Unit(benchmark::kMicrosecond)->TEST_SIZE;
+BENCHMARK_REGISTER_F(SortingBmk_columns, ChainedRadixArgsort)->Unit(benchmark::kMillisecond)->COLUMNS_SWEEP;
 
-BENCHMARK_DEFINE_F(SortingBmk_uniform_1B, MSDRadixSort)
+BENCHMARK_DEFINE_F(SortingBmk_columns, RadixArgsortColumns)
 (benchmark::State& state)
 {
     const auto n = state.range(0);
 
-    std::vector<T> values(m_vals.size());
+    std::vector<uint32_t> indices(n);
+    argsort_scratch<T> scratch;
+    perf_counters::scope measure(state, state.range(0));
     for (auto _ : state) {
-        std::copy(m_vals.begin(), m_vals.end(), values.begin());
-
-        radix_sort_msd(values);
-        benchmark::DoNotOptimize(values);
+        radix_argsort_columns(m_columns.data(), m_columns.size(), n, indices.data(), scratch);
+        benchmark::DoNotOptimize(indices);
         benchmark::ClobberMemory();
     }
 }
-BENCHMARK_REGISTER_F(SortingBmk_uniform_1B, MSDRadixSort)->Unit(benchmark::kMicrosecond)->TEST_SIZE;
+BENCHMARK_REGISTER_F(SortingBmk_columns, RadixArgsortColumns)->Unit(benchmark::kMillisecond)->COLUMNS_SWEEP;
+
+/// external sort of a file of uniform random keys with a memory cap: {n, budget in MB}, a budget
+/// of 2 * 8n bytes or more sorts the file in memory
+///
+#define EXTERNAL_SWEEP ArgsProduct({ { 1 << 24 }, { 8, 32, 256 } })->ArgNames({ "n", "budgetMB" })->UseRealTime()
+
+/// the files and the buckets go to a directory of their own, so that concurrent runs don't clobber
+/// each other
+///
+class SortingBmk_external : public benchmark::Fixture {
+public:
+    std::string m_dir, m_input, m_output;
+
+    void SetUp(const ::benchmark::State& state)
+    {
+        char pattern[] = "/tmp/external_bmk.XXXXXX";
+        if (::mkdtemp(pattern) == nullptr)
+            throw std::system_error(errno, std::generic_category(), "mkdtemp");
+        m_dir = pattern;
+        m_input = m_dir + "/input";
+        m_output = m_dir + "/output";
+
+        const auto n = state.range(0);
+        std::vector<T> vals(n);
+        std::mt19937_64 generator;
+        for (auto& value : vals)
+            value = generator();
+        FILE* f = std::fopen(m_input.c_str(), "wb");
+        std::fwrite(vals.data(), sizeof(T), n, f);
+        std::fclose(f);
+    }
 
-BENCHMARK_DEFINE_F(SortingBmk_uniform_1B, HybridRadixSort)
+    void TearDown(const ::benchmark::State& state)
+    {
+        std::remove(m_input.c_str());
+        std::remove(m_output.c_str());
+        ::rmdir(m_dir.c_str());
+    }
+};
+
+// the baseline which fits the memory: read, radix_sort_hybrid, write
+BENCHMARK_DEFINE_F(SortingBmk_external, InMemoryHybridRadixSort)
 (benchmark::State& state)
 {
     const auto n = state.range(0);
-
-    std::vector<T> values(m_vals.size());
+    perf_counters::scope measure(state, state.range(0));
     for (auto _ : state) {
-        std::copy(m_vals.begin(), m_vals.end(), values.begin());
-
+        std::vector<T> values(n);
+        FILE* f = std::fopen(m_input.c_str(), "rb");
+        benchmark::DoNotOptimize(std::fread(values.data(), sizeof(T), n, f));
+        std::fclose(f);
         radix_sort_hybrid(values);
-        benchmark::DoNotOptimize(values);
-        benchmark::ClobberMemory();
+        f = std::fopen(m_output.c_str(), "wb");
+        std::fwrite(values.data(), sizeof(T), n, f);
+        std::fclose(f);
     }
 }
-BENCHMARK_REGISTER_F(SortingBmk_uniform_1B, HybridRadixSort)->Unit(benchmark::kMicrosecond)->TEST_SIZE;
+BENCHMARK_REGISTER_F(SortingBmk_external, InMemoryHybridRadixSort)->Unit(benchmark::kMillisecond)->Args({ 1 << 24, 0 })->ArgNames({ "n", "budgetMB" })->UseRealTime();
 
-BENCHMARK_MAIN();
+BENCHMARK_DEFINE_F(SortingBmk_external, ExternalRadixSort)
+(benchmark::State& state)
+{
+    external_sort_options options;
+    options.memoryBudget = (size_t)state.range(1) << 20;
+    options.tmpDir = m_dir;
+    perf_counters::scope measure(state, state.range(0));
+    for (auto _ : state) {
+        try {
+            radix_sort_external(m_input, m_output, options);
+        } catch (const std::exception& e) {
+            // a full disk: TearDown still removes the files, the sort removed its buckets
+            state.SkipWithError(e.what());
+            break;
+        }
+    }
+}
+BENCHMARK_REGISTER_F(SortingBmk_external, ExternalRadixSort)->Unit(benchmark::kMillisecond)->EXTERNAL_SWEEP;
+
+// The sorts, see sort_registry.h
+void register_sorts()
+{
+    using namespace sort_registry;
+    // the sizes of the plain sorts, the parallel ones only pay off on the inputs much larger
+    const auto testSizes = dense_sizes(10000, 600000, 50000);
+    const std::vector<int64_t> threadsSizes = { 1 << 20, 1 << 24 };
+
+    const auto all = sort_algorithms<T>();
+    const std::vector<distribution<T>> dists = {
+        distributions::all_unique<T>(),
+        // uniform random numbers in the range [0, 1e9]
+        distributions::uniform_up_to<T>("uniform_1B", 1000000000),
+        // uniform random 48-bit keys: 6 passes of 8-bit digits, 5 of 11-bit digits, 3 of 16-bit digits
+        distributions::uniform_up_to<T>("uniform_48bit", ((T)1 << 48) - 1),
+    };
+    sort_registry::register_sorts(dists, serial(all), testSizes, benchmark::kMicrosecond);
+    sort_registry::register_sorts(dists, parallel(all), threadsSizes, benchmark::kMillisecond);
+
+    // the scatter kernels only differ once the buckets don't fit into the caches, 1M to 1B keys
+    sort_registry::register_sorts({ dists[1] },
+        select(all, { "LSDRadixSort", "HybridRadixSort", "LSDRadixSortBuffered", "HybridRadixSortBuffered", "LSDRadixSortBufferedNT", "HybridRadixSortBufferedNT" }),
+        log_sizes(1 << 20, 1 << 30), benchmark::kMillisecond);
+
+    // Signed, floating point and narrow keys, see radix_key.h, radix_digits::levels and radix_counting_sort.h
+    sort_registry::register_sorts({ distributions::uniform<int64_t>() }, serial(sort_algorithms<int64_t>()), testSizes, benchmark::kMicrosecond);
+    sort_registry::register_sorts({ distributions::uniform<double>() }, serial(sort_algorithms<double>()), testSizes, benchmark::kMicrosecond);
+    sort_registry::register_sorts({ distributions::uniform<float>() }, serial(sort_algorithms<float>()), testSizes, benchmark::kMicrosecond);
+    sort_registry::register_sorts({ distributions::uniform<uint32_t>() }, serial(sort_algorithms<uint32_t>()), testSizes, benchmark::kMicrosecond);
+    sort_registry::register_sorts({ distributions::uniform<uint16_t>() }, serial(sort_algorithms<uint16_t>()), testSizes, benchmark::kMicrosecond);
+    sort_registry::register_sorts({ distributions::uniform<uint8_t>() }, serial(sort_algorithms<uint8_t>()), testSizes, benchmark::kMicrosecond);
+}
+
+int main(int argc, char** argv)
+{
+    register_sorts();
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
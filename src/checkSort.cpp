@@ -1,35 +1,786 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <numeric>
 #include <random>
+#include <stdexcept>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
 #include <vector>
 
+#include "radix_sort_columns.h"
+#include "radix_sort_external.h"
+#include "radix_merge.h"
 #include "radix_sort_hybrid.h"
+#include "radix_sort_inplace.h"
 #include "radix_sort_lsd.h"
 #include "radix_sort_msd.h"
+#include "radix_sort_strings.h"
+#include "radix_select.h"
+#include "radix_sort.h"
+#include "radix_tuning.h"
+#include "radix_unique.h"
+
+// the 128-bit keys in the messages, hex as their words
+template <class T, class = decltype(T::hi)>
+std::ostream& operator<<(std::ostream& out, const T& value)
+{
+    return out << std::hex << "0x" << (uint64_t)value.hi << "_" << value.lo << std::dec;
+}
+
+template <class T>
+void checkSorted(const std::vector<T>& vals, const std::vector<T>& expected, const char* name)
+{
+    for (size_t i = 1; i < vals.size(); ++i) {
+        if (radix_less()(vals[i], vals[i - 1])) {
+            std::cout << name << ": " << vals[i - 1] << " > " << vals[i] << std::endl;
+            throw "something went wrong";
+        }
+    }
+    // compares the keys, NaN != NaN
+    if (!std::equal(vals.begin(), vals.end(), expected.begin(), expected.end(), [](T l, T r) { return radix_key(l) == radix_key(r); })) {
+        std::cout << name << ": not a permutation of the input" << std::endl;
+        throw "something went wrong";
+    }
+}
+
+template <class T, class I>
+void checkIndices(const std::vector<T>& vals, const std::vector<I>& indices, const char* name)
+{
+    std::vector<I> expected(vals.size());
+    std::iota(expected.begin(), expected.end(), 0);
+    std::stable_sort(expected.begin(), expected.end(), [&vals](I l, I r) { return radix_less()(vals[l], vals[r]); });
+    if (indices != expected) {
+        std::cout << name << ": indices differ from std::stable_sort" << std::endl;
+        throw "something went wrong";
+    }
+}
+
+// the selections of radix_select.h against the sorted `expected`
+template <class T>
+void checkSelect(const std::vector<T>& vals, const std::vector<T>& expected)
+{
+    const size_t n = vals.size();
+    for (size_t k : { (size_t)0, n / 3, n / 2, n - 1 }) {
+        std::vector<T> selected(vals);
+        radix_nth_element(&selected[0], n, k);
+        if (radix_key(selected[k]) != radix_key(expected[k]) || radix_key(radix_select(vals.data(), n, k)) != radix_key(expected[k])) {
+            std::cout << "radix_nth_element: wrong element of rank " << k << std::endl;
+            throw "something went wrong";
+        }
+        for (size_t i = 0; i < n; ++i) {
+            if (i < k ? radix_less()(selected[k], selected[i]) : radix_less()(selected[i], selected[k])) {
+                std::cout << "radix_nth_element: not partitioned around rank " << k << std::endl;
+                throw "something went wrong";
+            }
+        }
+    }
+
+    const size_t k = std::min<size_t>(n, 1000);
+    std::vector<T> partial(vals);
+    radix_partial_sort(&partial[0], n, k);
+    partial.resize(k);
+    checkSorted(partial, std::vector<T>(expected.begin(), expected.begin() + k), "radix_partial_sort");
+
+    const double quantiles[] = { 0.99, 0.5, 0.0, 1.0, 0.25, 0.5 };
+    T out[6];
+    std::vector<T> permuted(vals);
+    radix_quantiles(&permuted[0], n, quantiles, 6, out);
+    for (size_t i = 0; i < 6; ++i) {
+        if (radix_key(out[i]) != radix_key(expected[(size_t)(quantiles[i] * (n - 1))])) {
+            std::cout << "radix_quantiles: wrong quantile " << quantiles[i] << std::endl;
+            throw "something went wrong";
+        }
+    }
+
+    std::vector<uint32_t> top(k), expectedTop(n);
+    radix_top_k_indices(vals.data(), n, k, top.data());
+    std::iota(expectedTop.begin(), expectedTop.end(), 0);
+    std::stable_sort(expectedTop.begin(), expectedTop.end(), [&vals](uint32_t l, uint32_t r) { return radix_less()(vals[l], vals[r]); });
+    expectedTop.resize(k);
+    if (top != expectedTop) {
+        std::cout << "radix_top_k_indices: indices differ from std::stable_sort" << std::endl;
+        throw "something went wrong";
+    }
+}
+
+// the runs of radix_unique.h against the run lengths of the sorted `expected`
+template <class T>
+void checkRuns(const std::vector<T>& vals, const std::vector<T>& expected)
+{
+    std::vector<T> expectedKeys;
+    std::vector<size_t> expectedCounts;
+    for (size_t i = 0; i < expected.size(); ++i) {
+        if (i == 0 || radix_key(expected[i]) != radix_key(expected[i - 1])) {
+            expectedKeys.push_back(expected[i]);
+            expectedCounts.push_back(0);
+        }
+        ++expectedCounts.back();
+    }
+    auto sameKeys = [](const std::vector<T>& l, const std::vector<T>& r) {
+        return std::equal(l.begin(), l.end(), r.begin(), r.end(), [](T a, T b) { return radix_key(a) == radix_key(b); });
+    };
+
+    std::vector<T> keys;
+    std::vector<size_t> counts;
+    radix_sort_count(vals, keys, counts);
+    if (!sameKeys(keys, expectedKeys) || counts != expectedCounts) {
+        std::cout << "radix_sort_count: " << keys.size() << " runs, expected " << expectedKeys.size() << std::endl;
+        throw "something went wrong";
+    }
+    radix_sort_unique(vals, keys);
+    if (!sameKeys(keys, expectedKeys)) {
+        std::cout << "radix_sort_unique: " << keys.size() << " keys, expected " << expectedKeys.size() << std::endl;
+        throw "something went wrong";
+    }
+}
+
+// the sorts which take any key type, on the keys which aren't unsigned integers
+template <class T>
+void checkKeyType(const std::vector<T>& vals)
+{
+    std::vector<T> expected(vals);
+    std::sort(expected.begin(), expected.end(), radix_less());
+
+    std::vector<T> sorted(vals);
+    radix_sort_hybrid(sorted);
+    checkSorted(sorted, expected, "radix_sort_hybrid(key type)");
+
+    radix_sort_hybrid_copy(vals.data(), vals.size(), &sorted[0]);
+    checkSorted(sorted, expected, "radix_sort_hybrid_copy(key type)");
+
+    sorted = vals;
+    radix_sort_hybrid_parallel(sorted, 4);
+    checkSorted(sorted, expected, "radix_sort_hybrid_parallel(key type)");
+
+    sorted = vals;
+    radix_sort_msd(sorted);
+    checkSorted(sorted, expected, "radix_sort_msd(key type)");
+
+    sorted = vals;
+    radix_sort_lsd_travis(&sorted[0], sorted.size());
+    checkSorted(sorted, expected, "radix_sort_lsd_travis(key type)");
+
+    sorted = vals;
+    radix_sort_lsd_travis<16>(&sorted[0], sorted.size());
+    checkSorted(sorted, expected, "radix_sort_lsd_travis<16>(key type)");
+
+    sorted = vals;
+    radix_sort_lsd_parallel(&sorted[0], sorted.size(), 4);
+    checkSorted(sorted, expected, "radix_sort_lsd_parallel(key type)");
+
+    sorted = vals;
+    radix_sort_inplace(&sorted[0], sorted.size());
+    checkSorted(sorted, expected, "radix_sort_inplace(key type)");
+
+    sorted = vals;
+    radix_sort_inplace_stable(&sorted[0], sorted.size(), 100);
+    checkSorted(sorted, expected, "radix_sort_inplace_stable(key type)");
+
+    std::vector<uint32_t> payload(vals.size());
+    std::iota(payload.begin(), payload.end(), 0);
+    sorted = vals;
+    radix_sort_inplace_stable(&sorted[0], &payload[0], sorted.size(), 100);
+    checkIndices(vals, payload, "radix_sort_inplace_stable(key type, payload)");
+
+    sorted = vals;
+    radix_sort(sorted);
+    checkSorted(sorted, expected, "radix_sort(key type)");
+
+    std::vector<uint32_t> indices;
+    radix_argsort_hybrid(vals, indices);
+    checkIndices(vals, indices, "radix_argsort_hybrid(key type)");
+
+    checkSelect(vals, expected);
+    checkRuns(vals, expected);
+
+    // sorted and descending take the presorted paths
+    std::sort(sorted.begin(), sorted.end(), radix_less());
+    std::reverse(sorted.begin(), sorted.end());
+    radix_sort_hybrid(sorted);
+    checkSorted(sorted, expected, "radix_sort_hybrid(key type, descending)");
+}
+
+// the nullable sorts of radix_nulls.h against the sort of the compacted values
+template <class T>
+void checkNulls(const std::vector<T>& vals, const std::vector<uint8_t>& validity, null_placement placement)
+{
+    const size_t n = vals.size();
+    std::vector<T> expected;
+    std::vector<uint32_t> expectedIndices, nullIndices;
+    for (size_t i = 0; i < n; ++i) {
+        if (is_valid(validity.data(), i)) {
+            expected.push_back(vals[i]);
+            expectedIndices.push_back(i);
+        } else {
+            nullIndices.push_back(i);
+        }
+    }
+    std::sort(expected.begin(), expected.end(), radix_less());
+    std::stable_sort(expectedIndices.begin(), expectedIndices.end(), [&vals](uint32_t l, uint32_t r) { return radix_less()(vals[l], vals[r]); });
+    expectedIndices.insert(placement == null_placement::at_start ? expectedIndices.begin() : expectedIndices.end(), nullIndices.begin(), nullIndices.end());
+    const size_t nullCount = nullIndices.size();
+    const size_t validBegin = placement == null_placement::at_start ? nullCount : 0;
+
+    std::vector<T> sorted(vals);
+    std::vector<uint8_t> sortedValidity(validity);
+    if (radix_sort_hybrid(&sorted[0], n, sortedValidity.data(), placement) != nullCount) {
+        std::cout << "radix_sort_hybrid(nulls): wrong null count" << std::endl;
+        throw "something went wrong";
+    }
+    for (size_t i = 0; i < n; ++i) {
+        if (is_valid(sortedValidity.data(), i) != (i >= validBegin && i < validBegin + n - nullCount)) {
+            std::cout << "radix_sort_hybrid(nulls): wrong validity of " << i << std::endl;
+            throw "something went wrong";
+        }
+    }
+    checkSorted(std::vector<T>(sorted.begin() + validBegin, sorted.begin() + validBegin + n - nullCount), expected, "radix_sort_hybrid(nulls)");
+
+    std::vector<uint32_t> indices(n);
+    if (radix_argsort_hybrid(vals.data(), n, validity.data(), placement, indices.data()) != nullCount || indices != expectedIndices) {
+        std::cout << "radix_argsort_hybrid(nulls): indices differ from std::stable_sort" << std::endl;
+        throw "something went wrong";
+    }
+}
+
+// A directory of its own under /tmp for the checks which go through files, so that concurrent
+// runs don't clobber each other: removed with the files named by file() when it goes out of scope.
+class temp_dir {
+public:
+    temp_dir()
+    {
+        char pattern[] = "/tmp/checkSort.XXXXXX";
+        if (::mkdtemp(pattern) == nullptr) {
+            std::cout << "mkdtemp failed" << std::endl;
+            throw "something went wrong";
+        }
+        m_path = pattern;
+    }
+    temp_dir(const temp_dir&) = delete;
+    temp_dir& operator=(const temp_dir&) = delete;
+    ~temp_dir()
+    {
+        for (const auto& file : m_files)
+            std::remove(file.c_str());
+        ::rmdir(m_path.c_str());
+    }
+
+    const std::string& path() const { return m_path; }
+    std::string file(const std::string& name)
+    {
+        m_files.push_back(m_path + "/" + name);
+        return m_files.back();
+    }
+
+private:
+    std::string m_path;
+    std::vector<std::string> m_files;
+};
+
+// through files in a temp_dir, a budget of budgetKeys keys
+template <class T>
+void checkExternal(const std::vector<T>& vals, size_t budgetKeys)
+{
+    temp_dir dir;
+    const std::string input = dir.file("external.in"), output = dir.file("external.out");
+    FILE* f = std::fopen(input.c_str(), "wb");
+    std::fwrite(vals.data(), sizeof(T), vals.size(), f);
+    std::fclose(f);
+
+    external_sort_options options;
+    options.memoryBudget = budgetKeys * sizeof(T);
+    options.tmpDir = dir.path(); // the bucket files
+    radix_sort_external<8, T>(input, output, options);
+
+    std::vector<T> sorted(vals.size() + 1);
+    f = std::fopen(output.c_str(), "rb");
+    sorted.resize(std::fread(sorted.data(), sizeof(T), sorted.size(), f));
+    std::fclose(f);
+
+    std::vector<T> expected(vals);
+    std::sort(expected.begin(), expected.end(), radix_less());
+    checkSorted(sorted, expected, "radix_sort_external");
+}
 
 // was lazy to install gtests on my personal machine
+// The function try block unwinds a failed check, so the temp_dir of the checks are removed too
 int main(int, char**)
-{
+try {
     using T = uint64_t;
-    const auto n = 1000;
-    std::vector<T> vals(n); //  = {6, 7, 11, 10, 6};
+    // reused by all the sizes, the presorted inputs below get a larger scratch than they need
+    std::vector<T> scratch;
+    argsort_scratch<T> indicesScratch;
+    // the sizes cover the small sort, the LSD tail and the MSD levels of the hybrid sort
+    for (size_t n : { 1000, 100000, 400000 }) {
+        std::vector<T> vals(n); //  = {6, 7, 11, 10, 6};
 
-    std::default_random_engine generator;
-    std::uniform_int_distribution<T> distribution(0, n);
+        std::default_random_engine generator;
+        std::uniform_int_distribution<T> distribution(0, n);
 
-    for (int i = 0; i < n; ++i) {
-        vals[i] = distribution(generator);
+        for (size_t i = 0; i < n; ++i) {
+            vals[i] = distribution(generator);
+        }
+
+        std::shuffle(vals.begin(), vals.end(), std::mt19937 { std::random_device {}() });
+
+        std::vector<T> expected(vals);
+        std::sort(expected.begin(), expected.end());
+
+        std::vector<T> sorted(vals);
+        radix_sort_hybrid(sorted);
+        checkSorted(sorted, expected, "radix_sort_hybrid");
+
+        sorted = vals;
+        radix_sort_hybrid(sorted, scratch);
+        checkSorted(sorted, expected, "radix_sort_hybrid(scratch)");
+
+        // the out-of-place sort must leave its source alone
+        const std::vector<T> source(vals);
+        radix_sort_hybrid_copy(source.data(), source.size(), &sorted[0]);
+        checkSorted(sorted, expected, "radix_sort_hybrid_copy");
+        if (source != vals) {
+            std::cout << "radix_sort_hybrid_copy: modified its source" << std::endl;
+            throw "something went wrong";
+        }
+
+        sorted = vals;
+        radix_sort_hybrid<11>(sorted);
+        checkSorted(sorted, expected, "radix_sort_hybrid<11>");
+
+        sorted = vals;
+        radix_sort_hybrid<8, scatter_mode::buffered>(sorted);
+        checkSorted(sorted, expected, "radix_sort_hybrid<buffered>");
+
+        sorted = vals;
+        radix_sort_hybrid<8, scatter_mode::buffered_nt>(sorted);
+        checkSorted(sorted, expected, "radix_sort_hybrid<buffered_nt>");
+
+        sorted = vals;
+        radix_sort_hybrid_parallel(sorted, 4);
+        checkSorted(sorted, expected, "radix_sort_hybrid_parallel");
+
+        sorted = vals;
+        radix_sort_msd(sorted);
+        checkSorted(sorted, expected, "radix_sort_msd");
+
+        sorted = vals;
+        radix_sort_msd(sorted, scratch);
+        checkSorted(sorted, expected, "radix_sort_msd(scratch)");
+
+        sorted = vals;
+        radix_sort_msd<11>(sorted);
+        checkSorted(sorted, expected, "radix_sort_msd<11>");
+
+        sorted = vals;
+        radix_sort_lsd_travis(&sorted[0], sorted.size());
+        checkSorted(sorted, expected, "radix_sort_lsd_travis");
+
+        sorted = vals;
+        radix_sort_lsd_travis(&sorted[0], sorted.size(), &scratch[0]);
+        checkSorted(sorted, expected, "radix_sort_lsd_travis(scratch)");
+
+        sorted = vals;
+        radix_sort_lsd_travis<11>(&sorted[0], sorted.size());
+        checkSorted(sorted, expected, "radix_sort_lsd_travis<11>");
+
+        sorted = vals;
+        radix_sort_lsd_travis<16>(&sorted[0], sorted.size());
+        checkSorted(sorted, expected, "radix_sort_lsd_travis<16>");
+
+        sorted = vals;
+        radix_sort_lsd_travis<8, scatter_mode::buffered_nt>(&sorted[0], sorted.size());
+        checkSorted(sorted, expected, "radix_sort_lsd_travis<buffered_nt>");
+
+        sorted = vals;
+        radix_sort_lsd_parallel(&sorted[0], sorted.size(), 4);
+        checkSorted(sorted, expected, "radix_sort_lsd_parallel");
+
+        sorted = vals;
+        radix_sort_inplace(&sorted[0], sorted.size());
+        checkSorted(sorted, expected, "radix_sort_inplace");
+
+        sorted = vals;
+        radix_sort_inplace<11>(&sorted[0], sorted.size());
+        checkSorted(sorted, expected, "radix_sort_inplace<11>");
+
+        sorted = vals;
+        radix_sort_inplace_parallel(&sorted[0], sorted.size(), 4);
+        checkSorted(sorted, expected, "radix_sort_inplace_parallel");
+
+        sorted = vals;
+        radix_sort_inplace_stable(&sorted[0], sorted.size());
+        checkSorted(sorted, expected, "radix_sort_inplace_stable");
+
+        // a scratch much smaller than the runs takes the rotating merge
+        sorted = vals;
+        radix_sort_inplace_stable(&sorted[0], sorted.size(), 100);
+        checkSorted(sorted, expected, "radix_sort_inplace_stable(100)");
+
+        // the payload of the equal keys keeps the input order
+        std::vector<uint32_t> payload(n);
+        std::iota(payload.begin(), payload.end(), 0);
+        sorted = vals;
+        radix_sort_inplace_stable(&sorted[0], &payload[0], sorted.size(), 100);
+        checkSorted(sorted, expected, "radix_sort_inplace_stable(payload)");
+        checkIndices(vals, payload, "radix_sort_inplace_stable(payload)");
+
+        std::vector<uint32_t> indices;
+        radix_argsort_hybrid(vals, indices);
+        checkIndices(vals, indices, "radix_argsort_hybrid<uint32_t>");
+
+        radix_argsort_hybrid(vals, indices, indicesScratch);
+        checkIndices(vals, indices, "radix_argsort_hybrid(scratch)");
+
+        std::vector<uint64_t> indices64;
+        radix_argsort_hybrid(vals, indices64);
+        checkIndices(vals, indices64, "radix_argsort_hybrid<uint64_t>");
+
+        checkSelect(vals, expected);
+        checkRuns(vals, expected);
     }
 
-    std::shuffle(vals.begin(), vals.end(), std::mt19937 { std::random_device {}() });
+    // the fast paths of radix_presorted.h
+    const size_t n = 100000;
+    std::vector<std::vector<T>> presorted(5, std::vector<T>(n));
+    for (size_t i = 0; i < n; ++i) {
+        presorted[0][i] = i / 3; // sorted
+        presorted[1][i] = (n - i) / 3; // descending
+        presorted[2][i] = (i % (n / 5)) * 7; // 5 runs
+        presorted[3][i] = i; // a few outliers, see below
+        presorted[4][i] = (i % (n / 16)) * 16 + i / (n / 16); // 16 runs over the whole range, too many outliers
+    }
+    for (size_t i = 0; i < n; i += 997) {
+        std::swap(presorted[3][i], presorted[3][(i * 7919) % n]);
+    }
+    for (const auto& vals : presorted) {
+        std::vector<T> expected(vals);
+        std::sort(expected.begin(), expected.end());
+
+        std::vector<T> sorted(vals);
+        radix_sort_hybrid(sorted);
+        checkSorted(sorted, expected, "radix_sort_hybrid(presorted)");
+
+        sorted = vals;
+        radix_sort_hybrid(sorted, scratch);
+        checkSorted(sorted, expected, "radix_sort_hybrid(presorted, scratch)");
+
+        sorted = vals;
+        radix_sort_hybrid_parallel(sorted, 4);
+        checkSorted(sorted, expected, "radix_sort_hybrid_parallel(presorted)");
 
-    radix_sort_hybrid(vals);
+        radix_sort_hybrid_copy(vals.data(), vals.size(), &sorted[0]);
+        checkSorted(sorted, expected, "radix_sort_hybrid_copy(presorted)");
+
+        std::vector<uint32_t> indices;
+        radix_argsort_hybrid(vals, indices);
+        checkIndices(vals, indices, "radix_argsort_hybrid(presorted)");
+    }
+
+    // nullable columns: no nulls, some, all, both placements and a count which isn't a multiple of 8
+    for (size_t percent : { 0, 10, 50, 90, 100 }) {
+        for (size_t count : { n, n + 5 }) {
+            std::vector<T> vals(count);
+            std::vector<uint8_t> validity((count + 7) / 8);
+            std::default_random_engine generator;
+            std::uniform_int_distribution<T> distribution(0, count / 4);
+            for (size_t i = 0; i < count; ++i) {
+                vals[i] = distribution(generator);
+                set_validity(validity.data(), i, i + 1, generator() % 100 >= percent);
+            }
+            checkNulls(vals, validity, null_placement::at_start);
+            checkNulls(vals, validity, null_placement::at_end);
+        }
+    }
 
-    for (size_t i = 1; i < n; ++i) {
-        if (vals[i - 1] > vals[i]) {
-            std::cout << vals[i - 1] << " > " << vals[i] << std::endl;
+    // ORDER BY of several columns against std::stable_sort with the lexicographic comparison
+    for (size_t rows : { (size_t)1000, n }) {
+        std::default_random_engine generator;
+        std::vector<std::vector<int64_t>> table(4, std::vector<int64_t>(rows));
+        const int64_t cardinality[] = { 7, 100, 3, (int64_t)rows };
+        for (size_t c = 0; c < table.size(); ++c) {
+            std::uniform_int_distribution<int64_t> distribution(-cardinality[c], cardinality[c]);
+            for (auto& value : table[c])
+                value = distribution(generator);
+        }
+        // the columns have their own key types, all of them keep the order of the int64_t values
+        std::vector<int32_t> int32Column(table[0].begin(), table[0].end());
+        std::vector<uint16_t> uint16Column;
+        for (int64_t value : table[2])
+            uint16Column.push_back((uint16_t)(value + cardinality[2]));
+        std::vector<double> doubleColumn(table[3].begin(), table[3].end());
+        const sort_column typed[] = { { int32Column.data() }, { table[1].data(), true }, { uint16Column.data() }, { doubleColumn.data(), true } };
+        for (size_t numColumns : { 1, 2, 3, 4 }) {
+            std::vector<sort_column> columns(typed, typed + numColumns);
+            std::vector<uint32_t> expected(rows);
+            std::iota(expected.begin(), expected.end(), 0);
+            std::stable_sort(expected.begin(), expected.end(), [&table, numColumns](uint32_t l, uint32_t r) {
+                for (size_t c = 0; c < numColumns; ++c) {
+                    if (table[c][l] != table[c][r])
+                        return (table[c][l] < table[c][r]) != (c % 2 == 1);
+                }
+                return false;
+            });
+            std::vector<uint32_t> indices;
+            radix_argsort_columns(columns, rows, indices);
+            if (indices != expected) {
+                std::cout << "radix_argsort_columns(" << numColumns << "): indices differ from std::stable_sort" << std::endl;
+                throw "something went wrong";
+            }
+        }
+    }
+
+    // strings against std::stable_sort by the bytes: random ones, shared prefixes longer than a
+    // chunk, empty ones, zero bytes and duplicates
+    for (size_t rows : { (size_t)1000, n / 4 }) {
+        std::default_random_engine generator;
+        const std::string prefixes[] = { "", "https://www.example.com/", "https://www.example.com/a/b/", std::string("\0\0\xe9", 3) };
+        std::vector<int64_t> offsets = { 0 };
+        std::vector<uint8_t> data;
+        for (size_t i = 0; i < rows; ++i) {
+            const std::string& prefix = prefixes[generator() % 4];
+            data.insert(data.end(), prefix.begin(), prefix.end());
+            const size_t length = generator() % 20;
+            for (size_t c = 0; c < length; ++c)
+                data.push_back((uint8_t)(generator() % 4 == 0 ? 0 : generator() % 8 == 0 ? 0xe9 : 'a' + generator() % 3));
+            offsets.push_back((int64_t)data.size());
+        }
+        const auto str = [&](uint32_t row) { return std::string(data.begin() + offsets[row], data.begin() + offsets[row + 1]); };
+        std::vector<uint32_t> expected(rows);
+        std::iota(expected.begin(), expected.end(), 0);
+        std::stable_sort(expected.begin(), expected.end(), [&str](uint32_t l, uint32_t r) { return str(l) < str(r); });
+        std::vector<uint32_t> indices;
+        radix_argsort_strings(offsets, data, indices);
+        const std::vector<int32_t> offsets32(offsets.begin(), offsets.end());
+        std::vector<uint32_t> indices32;
+        radix_argsort_strings(offsets32, data, indices32);
+        if (indices != expected || indices32 != expected) {
+            std::cout << "radix_argsort_strings: indices differ from std::stable_sort" << std::endl;
+            throw "something went wrong";
+        }
+    }
+
+    // chunked arrays: sorted chunks, empty ones, duplicates across them, and a chunk out of order
+    for (size_t numChunks : { 1, 3, 16, 100 }) {
+        std::vector<T> chunked(n);
+        std::mt19937_64 chunkGenerator;
+        for (size_t i = 0; i < n; ++i) {
+            chunked[i] = chunkGenerator() % (n / 2);
+        }
+        std::vector<const T*> chunks;
+        std::vector<size_t> sizes;
+        for (size_t c = 0; c < numChunks; ++c) {
+            const size_t lo = n * c / numChunks, hi = c % 4 == 1 ? lo : n * (c + 1) / numChunks;
+            std::sort(chunked.begin() + lo, chunked.begin() + hi);
+            chunks.push_back(chunked.data() + lo);
+            sizes.push_back(hi - lo);
+        }
+        std::vector<T> expected;
+        for (size_t c = 0; c < numChunks; ++c) {
+            expected.insert(expected.end(), chunks[c], chunks[c] + sizes[c]);
+        }
+        std::sort(expected.begin(), expected.end());
+
+        std::vector<T> sorted(expected.size());
+        merge_sorted_runs(chunks.data(), sizes.data(), numChunks, sorted.data(), 4);
+        checkSorted(sorted, expected, "merge_sorted_runs");
+        radix_sort_chunks(chunks.data(), sizes.data(), numChunks, sorted.data(), 1);
+        checkSorted(sorted, expected, "radix_sort_chunks");
+
+        std::reverse(chunked.begin(), chunked.begin() + sizes[0]);
+        radix_sort_chunks(chunks.data(), sizes.data(), numChunks, sorted.data(), 4);
+        checkSorted(sorted, expected, "radix_sort_chunks(unsorted)");
+    }
+
+    // the external sort: the budget fits the input, a level of buckets, several, equal keys
+    std::vector<T> externalVals(n);
+    std::mt19937_64 externalGenerator;
+    for (size_t i = 0; i < n; ++i) {
+        externalVals[i] = i % 3 == 0 ? externalGenerator() : externalGenerator() % n;
+    }
+    for (size_t budget : { 2 * n, n / 4, (size_t)1024 }) {
+        checkExternal(externalVals, budget);
+    }
+    checkExternal(std::vector<T>(n, 42), 1024);
+    checkExternal(std::vector<T>(), 1024);
+    {
+        // a trailing partial key
+        temp_dir dir;
+        const std::string input = dir.file("external.in"), output = dir.file("external.out");
+        std::ofstream(input) << "9 bytes..";
+        bool thrown = false;
+        try {
+            radix_sort_external<8, T>(input, output);
+        } catch (const std::invalid_argument&) {
+            thrown = true;
+        }
+        if (!thrown) {
+            std::cout << "radix_sort_external: accepted a partial key" << std::endl;
+            throw "something went wrong";
+        }
+    }
+
+    // the tuning profiles: an LSD tail and a small sort of a few keys, no MSD level at all, 11-bit
+    // digits, and the profile files
+    const radix_tuning initialTuning = radix_tuning_profile();
+    for (const radix_tuning& tuning : { radix_tuning { 64, 2, 11 }, radix_tuning { (size_t)1 << 24, 64, 8 } }) {
+        set_radix_tuning_profile(tuning);
+        std::vector<T> expected(externalVals), sorted(externalVals);
+        std::sort(expected.begin(), expected.end());
+        radix_sort_hybrid_tuned(sorted.data(), sorted.size());
+        checkSorted(sorted, expected, "radix_sort_hybrid_tuned");
+        std::vector<uint32_t> indices;
+        radix_argsort_hybrid(externalVals, indices);
+        checkIndices(externalVals, indices, "radix_argsort_hybrid(tuned)");
+    }
+    set_radix_tuning_profile(initialTuning);
+    {
+        temp_dir dir;
+        const std::string profilePath = dir.file("tuning.conf");
+        std::ofstream(profilePath) << "# a comment\n\nlsd_threshold = 4096\nradix_bits = 11  # another\n";
+        radix_tuning tuning;
+        if (!tuning_impl::load_profile(profilePath, tuning) || tuning.lsdThreshold != 4096 || tuning.radixBits != 11
+            || tuning.smallSortThreshold != radix_tuning().smallSortThreshold) {
+            std::cout << "load_profile: wrong profile" << std::endl;
+            throw "something went wrong";
+        }
+        std::ofstream(profilePath) << "lsd_threshold = 4096\nunknown = 1\n";
+        if (tuning_impl::load_profile(profilePath, tuning)) {
+            std::cout << "load_profile: accepted an unknown key" << std::endl;
             throw "something went wrong";
         }
     }
 
+    // the front door on the shapes of every route, the obvious routes checked as well, and their runs
+    {
+        std::mt19937_64 shapeGenerator;
+        std::vector<T> shuffled(n), equal(n, 42), ascending(n), fewUnique(n), wide(n);
+        std::iota(ascending.begin(), ascending.end(), 0);
+        std::iota(shuffled.begin(), shuffled.end(), 0);
+        std::shuffle(shuffled.begin(), shuffled.end(), shapeGenerator);
+        for (size_t i = 0; i < n; ++i) {
+            fewUnique[i] = shapeGenerator() % 6;
+            wide[i] = shapeGenerator();
+        }
+        std::vector<T> descending(ascending.rbegin(), ascending.rend());
+        std::vector<T> almostSorted(ascending);
+        for (size_t i = 0; i < n / 1000; ++i)
+            std::swap(almostSorted[2], almostSorted[shapeGenerator() % n]);
+        const std::vector<T> tiny(wide.begin(), wide.begin() + 10);
+
+        const int ANY = -1; // up to the model and the machine
+        const struct {
+            const std::vector<T>& vals;
+            const char* name;
+            int route;
+        } shapes[] = {
+            { shuffled, "shuffled", ANY },
+            { equal, "equal", (int)sort_route::msd },
+            { ascending, "ascending", (int)sort_route::merge },
+            { descending, "descending", (int)sort_route::merge },
+            { almostSorted, "almost sorted", ANY },
+            { fewUnique, "few unique", ANY },
+            { wide, "64-bit", ANY },
+            { tiny, "tiny", (int)sort_route::comparison },
+        };
+        for (const auto& shape : shapes) {
+            std::vector<T> expected(shape.vals), sorted(shape.vals);
+            std::sort(expected.begin(), expected.end());
+            const sort_plan plan = radix_sort(sorted);
+            checkSorted(sorted, expected, "radix_sort");
+            checkRuns(shape.vals, expected);
+            if (shape.route != ANY && (int)plan.route != shape.route) {
+                std::cout << "radix_sort(" << shape.name << "): " << plan.describe() << std::endl;
+                throw "something went wrong";
+            }
+        }
+        checkRuns(std::vector<T>(), std::vector<T>());
+    }
+
+    // signed and floating point keys, the special values included
+    std::default_random_engine generator;
+    std::uniform_int_distribution<int64_t> ints(-(int64_t)n, n);
+    std::normal_distribution<double> doubles(0.0, 1e6);
+    std::vector<int64_t> int64s(n);
+    std::vector<int32_t> int32s(n);
+    std::vector<double> doubleVals(n);
+    std::vector<float> floatVals(n);
+    for (size_t i = 0; i < n; ++i) {
+        int64s[i] = ints(generator);
+        int32s[i] = (int32_t)ints(generator);
+        doubleVals[i] = doubles(generator);
+        floatVals[i] = (float)doubles(generator);
+    }
+    int64s[0] = INT64_MIN;
+    int64s[1] = INT64_MAX;
+    int32s[0] = INT32_MIN;
+    int32s[1] = INT32_MAX;
+    const double specials[] = { 0.0, -0.0, INFINITY, -INFINITY, NAN, -NAN, 1e-310, -1e-310, DBL_MAX, -DBL_MAX };
+    for (size_t i = 0; i < sizeof(specials) / sizeof(specials[0]); ++i) {
+        for (size_t j = i; j < n; j += n / 8) {
+            doubleVals[j] = specials[i];
+            floatVals[j] = (float)specials[i];
+        }
+    }
+    checkKeyType(int64s);
+    checkKeyType(int32s);
+    checkKeyType(doubleVals);
+    checkKeyType(floatVals);
+
+    // the narrow keys: fewer passes, and the counting sort for 8 and 16 bits
+    std::vector<uint32_t> uint32s(n);
+    std::vector<uint16_t> uint16s(n);
+    std::vector<int16_t> int16s(n);
+    std::vector<uint8_t> uint8s(n);
+    std::vector<int8_t> int8s(n);
+    for (size_t i = 0; i < n; ++i) {
+        const auto value = ints(generator);
+        uint32s[i] = (uint32_t)value * 2654435761u;
+        uint16s[i] = (uint16_t)value;
+        int16s[i] = (int16_t)value;
+        uint8s[i] = (uint8_t)value;
+        int8s[i] = (int8_t)value;
+    }
+    checkKeyType(uint32s);
+    checkKeyType(uint16s);
+    checkKeyType(int16s);
+    checkKeyType(uint8s);
+    checkKeyType(int8s);
+    // below the size the counting sort is worth it
+    checkKeyType(std::vector<int16_t>(int16s.begin(), int16s.begin() + 1000));
+    checkKeyType(std::vector<uint8_t>(uint8s.begin(), uint8s.begin() + 20));
+
+    // the 128-bit keys: high words of both signs, the decimals which fit into 64 bits, a common
+    // high word, which take the 64-bit sorts of the low words, and the hashes
+    std::vector<decimal128> decimals(n), smallDecimals(n), sameHighDecimals(n);
+    std::vector<uint128> hashes(n), sameHighHashes(n);
+    std::mt19937_64 wideGenerator;
+    for (size_t i = 0; i < n; ++i) {
+        decimals[i] = { wideGenerator(), (int64_t)(wideGenerator() % 7) - 3 };
+        const int64_t small = ints(generator);
+        smallDecimals[i] = { (uint64_t)small, small >> 63 };
+        sameHighDecimals[i] = { wideGenerator(), -2 };
+        hashes[i] = { wideGenerator(), wideGenerator() };
+        sameHighHashes[i] = { wideGenerator(), UINT64_MAX };
+    }
+    decimals[0] = { 0, INT64_MIN };
+    decimals[1] = { UINT64_MAX, INT64_MAX };
+    smallDecimals[0] = { (uint64_t)INT64_MIN, -1 };
+    smallDecimals[1] = { (uint64_t)INT64_MAX, 0 };
+    checkKeyType(decimals);
+    checkKeyType(smallDecimals);
+    checkKeyType(sameHighDecimals);
+    checkKeyType(hashes);
+    checkKeyType(sameHighHashes);
+
     return 0;
+} catch (const char* what) {
+    std::cout << what << std::endl;
+    return 1;
+} catch (const std::exception& e) {
+    std::cout << e.what() << std::endl;
+    return 1;
 }
@@ -1,540 +1,260 @@
 #include <benchmark/benchmark.h>
 
 #include <algorithm>
-#include <array>
-#include <boost/sort/spreadsort/spreadsort.hpp>
-#include <iostream>
+#include <functional>
+#include <numeric>
 #include <random>
+#include <string>
+#include <string_view>
 #include <vector>
 
+#include "perf_counters.h"
+#include "radix_merge.h"
 #include "radix_sort_hybrid.h"
-#include "radix_sort_lsd.h"
-#include "radix_sort_msd.h"
+#include "radix_sort_strings.h"
+#include "sort_registry.h"
 
-#define BMKBODY(SORT)                                                \
-    {                                                                \
-        const auto n = state.range(0);                               \
-        std::vector<T> values(m_vals.size());                        \
-        for (auto _ : state) {                                       \
-            std::copy(m_vals.begin(), m_vals.end(), values.begin()); \
-            SORT(values.begin(), values.end());                      \
-            benchmark::DoNotOptimize(values);                        \
-            benchmark::ClobberMemory();                              \
-        }                                                            \
-    }
-
-#define TEST_SIZE Arg(400000)
 #define TIME_UNIT Unit(benchmark::kMillisecond)
 
 using T = uint64_t;
 
-class SortingBmk_shuffled : public benchmark::Fixture {
-public:
-    std::vector<T> m_vals;
-
-    void SetUp(const ::benchmark::State& state)
-    {
-        const auto n = state.range(0);
-        m_vals.resize(n);
-        std::iota(m_vals.begin(), m_vals.end(), 0);
-
-        std::random_device rd;
-        std::mt19937 g(rd());
-        std::shuffle(m_vals.begin(), m_vals.end(), g);
-    }
-
-    void TearDown(const ::benchmark::State& state) { }
-};
-
-// We are interested in stable sort because it is currently used
-BENCHMARK_DEFINE_F(SortingBmk_shuffled, StdStableSort)
-(benchmark::State& state)
-{
-    BMKBODY(std::stable_sort);
-}
-BENCHMARK_REGISTER_F(SortingBmk_shuffled, StdStableSort)->TIME_UNIT->TEST_SIZE;
-
-BENCHMARK_DEFINE_F(SortingBmk_shuffled, BoostSpreadSort)
-(benchmark::State& state)
-{
-    BMKBODY(boost::sort::spreadsort::spreadsort);
-}
-BENCHMARK_REGISTER_F(SortingBmk_shuffled, BoostSpreadSort)->TIME_UNIT->TEST_SIZE;
-
-BENCHMARK_DEFINE_F(SortingBmk_shuffled, MSDRadixSort)
-(benchmark::State& state)
-{
-    const auto n = state.range(0);
-
-    std::vector<T> values(m_vals.size());
-    for (auto _ : state) {
-        std::copy(m_vals.begin(), m_vals.end(), values.begin());
-
-        radix_sort_msd(values);
-        benchmark::DoNotOptimize(values);
-        benchmark::ClobberMemory();
-    }
-}
-BENCHMARK_REGISTER_F(SortingBmk_shuffled, MSDRadixSort)->TIME_UNIT->TEST_SIZE;
-
-BENCHMARK_DEFINE_F(SortingBmk_shuffled, HybridRadixSort)
-(benchmark::State& state)
-{
-    const auto n = state.range(0);
-
-    std::vector<T> values(m_vals.size());
-    for (auto _ : state) {
-        std::copy(m_vals.begin(), m_vals.end(), values.begin());
-
-        radix_sort_hybrid(values);
-        benchmark::DoNotOptimize(values);
-        benchmark::ClobberMemory();
-    }
-}
-BENCHMARK_REGISTER_F(SortingBmk_shuffled, HybridRadixSort)->TIME_UNIT->TEST_SIZE;
-
-BENCHMARK_DEFINE_F(SortingBmk_shuffled, LSDRadixSort)
-(benchmark::State& state)
-{
-    const auto n = state.range(0);
-
-    std::vector<T> values(m_vals.size());
-    for (auto _ : state) {
-        std::copy(m_vals.begin(), m_vals.end(), values.begin());
-
-        radix_sort_lsd_travis(&values[0], values.size());
-        benchmark::DoNotOptimize(values);
-        benchmark::ClobberMemory();
-    }
-}
-BENCHMARK_REGISTER_F(SortingBmk_shuffled, LSDRadixSort)->TIME_UNIT->TEST_SIZE;
-
+/// k sorted runs of random keys, as the chunks of a chunked array: {n, k}
 ///
-class SortingBmk_allequal : public benchmark::Fixture {
-public:
-    std::vector<T> m_vals;
-
-    void SetUp(const ::benchmark::State& state)
-    {
-        const auto n = state.range(0);
-        m_vals.resize(n);
-
-        for (int i = 0; i < n; ++i) {
-            m_vals[i] = 1000000007; // a prime number
-        }
-    }
-
-    void TearDown(const ::benchmark::State& state) { }
-};
-
-// We are interested in stable sort because it is currently used
-BENCHMARK_DEFINE_F(SortingBmk_allequal, StdStableSort)
-(benchmark::State& state)
-{
-    BMKBODY(std::stable_sort);
-}
-BENCHMARK_REGISTER_F(SortingBmk_allequal, StdStableSort)->TIME_UNIT->TEST_SIZE;
+#define RUNS_SWEEP ArgsProduct({ { 400000, 1 << 24 }, { 4, 16, 64, 256, 1024 } })->ArgNames({ "n", "k" })
+// {n, k, threads}
+#define RUNS_THREADS_SWEEP ArgsProduct({ { 1 << 24 }, { 16, 64 }, benchmark::CreateRange(1, 32, 2) })->ArgNames({ "n", "k", "threads" })->UseRealTime()
 
-BENCHMARK_DEFINE_F(SortingBmk_allequal, BoostSpreadSort)
-(benchmark::State& state)
-{
-    BMKBODY(boost::sort::spreadsort::spreadsort);
-}
-BENCHMARK_REGISTER_F(SortingBmk_allequal, BoostSpreadSort)->TIME_UNIT->TEST_SIZE;
-
-BENCHMARK_DEFINE_F(SortingBmk_allequal, LSDRadixSort)
-(benchmark::State& state)
-{
-    // it is custom due to buffer
-    const auto n = state.range(0);
-
-    std::vector<T> values(m_vals.size());
-    for (auto _ : state) {
-        std::copy(m_vals.begin(), m_vals.end(), values.begin());
-
-        radix_sort_lsd_travis(&values.front(), values.size());
-        benchmark::DoNotOptimize(values);
-        benchmark::ClobberMemory();
-    }
-}
-BENCHMARK_REGISTER_F(SortingBmk_allequal, LSDRadixSort)->TIME_UNIT->TEST_SIZE;
-
-BENCHMARK_DEFINE_F(SortingBmk_allequal, MSDRadixSort)
-(benchmark::State& state)
-{
-    const auto n = state.range(0);
-
-    std::vector<T> values(m_vals.size());
-    for (auto _ : state) {
-        std::copy(m_vals.begin(), m_vals.end(), values.begin());
-
-        radix_sort_msd(values);
-        benchmark::DoNotOptimize(values);
-        benchmark::ClobberMemory();
-    }
-}
-BENCHMARK_REGISTER_F(SortingBmk_allequal, MSDRadixSort)->TIME_UNIT->TEST_SIZE;
-
-BENCHMARK_DEFINE_F(SortingBmk_allequal, HybridRadixSort)
-(benchmark::State& state)
-{
-    const auto n = state.range(0);
-
-    std::vector<T> values(m_vals.size());
-    for (auto _ : state) {
-        std::copy(m_vals.begin(), m_vals.end(), values.begin());
-
-        radix_sort_hybrid(values);
-        benchmark::DoNotOptimize(values);
-        benchmark::ClobberMemory();
-    }
-}
-BENCHMARK_REGISTER_F(SortingBmk_allequal, HybridRadixSort)->TIME_UNIT->TEST_SIZE;
-
-///
-class SortingBmk_ascending : public benchmark::Fixture {
+class SortingBmk_sortedruns : public benchmark::Fixture {
 public:
     std::vector<T> m_vals;
+    std::vector<const T*> m_chunks;
+    std::vector<size_t> m_sizes;
 
     void SetUp(const ::benchmark::State& state)
     {
         const auto n = state.range(0);
+        const auto k = state.range(1);
         m_vals.resize(n);
 
+        std::default_random_engine generator;
+        std::uniform_int_distribution<T> distribution(0, std::numeric_limits<T>::max());
         for (int i = 0; i < n; ++i) {
-            m_vals[i] = i;
+            m_vals[i] = distribution(generator);
         }
-    }
-
-    void TearDown(const ::benchmark::State& state) { }
-};
-
-// We are interested in stable sort because it is currently used
-BENCHMARK_DEFINE_F(SortingBmk_ascending, StdStableSort)
-(benchmark::State& state)
-{
-    BMKBODY(std::stable_sort);
-}
-BENCHMARK_REGISTER_F(SortingBmk_ascending, StdStableSort)->TIME_UNIT->TEST_SIZE;
-
-BENCHMARK_DEFINE_F(SortingBmk_ascending, BoostSpreadSort)
-(benchmark::State& state)
-{
-    BMKBODY(boost::sort::spreadsort::spreadsort);
-}
-BENCHMARK_REGISTER_F(SortingBmk_ascending, BoostSpreadSort)->TIME_UNIT->TEST_SIZE;
-
-BENCHMARK_DEFINE_F(SortingBmk_ascending, LSDRadixSort)
-(benchmark::State& state)
-{
-    // it is custom due to buffer
-    const auto n = state.range(0);
-
-    std::vector<T> values(m_vals.size());
-    for (auto _ : state) {
-        std::copy(m_vals.begin(), m_vals.end(), values.begin());
-
-        radix_sort_lsd_travis(&values.front(), values.size());
-        benchmark::DoNotOptimize(values);
-        benchmark::ClobberMemory();
-    }
-}
-BENCHMARK_REGISTER_F(SortingBmk_ascending, LSDRadixSort)->TIME_UNIT->TEST_SIZE;
-
-BENCHMARK_DEFINE_F(SortingBmk_ascending, MSDRadixSort)
-(benchmark::State& state)
-{
-    const auto n = state.range(0);
-
-    std::vector<T> values(m_vals.size());
-    for (auto _ : state) {
-        std::copy(m_vals.begin(), m_vals.end(), values.begin());
-
-        radix_sort_msd(values);
-        benchmark::DoNotOptimize(values);
-        benchmark::ClobberMemory();
-    }
-}
-BENCHMARK_REGISTER_F(SortingBmk_ascending, MSDRadixSort)->TIME_UNIT->TEST_SIZE;
-
-BENCHMARK_DEFINE_F(SortingBmk_ascending, HybridRadixSort)
-(benchmark::State& state)
-{
-    const auto n = state.range(0);
-
-    std::vector<T> values(m_vals.size());
-    for (auto _ : state) {
-        std::copy(m_vals.begin(), m_vals.end(), values.begin());
-
-        radix_sort_hybrid(values);
-        benchmark::DoNotOptimize(values);
-        benchmark::ClobberMemory();
-    }
-}
-BENCHMARK_REGISTER_F(SortingBmk_ascending, HybridRadixSort)->TIME_UNIT->TEST_SIZE;
-
-///
-class SortingBmk_descending : public benchmark::Fixture {
-public:
-    std::vector<T> m_vals;
-
-    void SetUp(const ::benchmark::State& state)
-    {
-        const auto n = state.range(0);
-        m_vals.resize(n);
-
-        for (int i = 0; i < n; ++i) {
-            m_vals[i] = (int)n - i;
+        m_chunks.clear();
+        m_sizes.clear();
+        for (int c = 0; c < k; ++c) {
+            const size_t lo = n * c / k, hi = n * (c + 1) / k;
+            std::sort(m_vals.begin() + lo, m_vals.begin() + hi);
+            m_chunks.push_back(m_vals.data() + lo);
+            m_sizes.push_back(hi - lo);
         }
     }
 
     void TearDown(const ::benchmark::State& state) { }
 };
 
-BENCHMARK_DEFINE_F(SortingBmk_descending, StdStableSort)
+// what we do now: the concatenation is sorted from scratch
+BENCHMARK_DEFINE_F(SortingBmk_sortedruns, HybridRadixSort)
 (benchmark::State& state)
 {
-    BMKBODY(std::stable_sort);
-}
-BENCHMARK_REGISTER_F(SortingBmk_descending, StdStableSort)->TIME_UNIT->TEST_SIZE;
-
-BENCHMARK_DEFINE_F(SortingBmk_descending, BoostSpreadSort)
-(benchmark::State& state)
-{
-    BMKBODY(boost::sort::spreadsort::spreadsort);
-}
-BENCHMARK_REGISTER_F(SortingBmk_descending, BoostSpreadSort)->TIME_UNIT->TEST_SIZE;
-
-BENCHMARK_DEFINE_F(SortingBmk_descending, LSDRadixSort)
-(benchmark::State& state)
-{
-    // it is custom due to buffer
-    const auto n = state.range(0);
-
     std::vector<T> values(m_vals.size());
+    perf_counters::scope measure(state, state.range(0));
     for (auto _ : state) {
         std::copy(m_vals.begin(), m_vals.end(), values.begin());
-
-        radix_sort_lsd_travis(&values.front(), values.size());
+        radix_sort_hybrid(values);
         benchmark::DoNotOptimize(values);
         benchmark::ClobberMemory();
     }
 }
-BENCHMARK_REGISTER_F(SortingBmk_descending, LSDRadixSort)->TIME_UNIT->TEST_SIZE;
+BENCHMARK_REGISTER_F(SortingBmk_sortedruns, HybridRadixSort)->TIME_UNIT->RUNS_SWEEP;
 
-BENCHMARK_DEFINE_F(SortingBmk_descending, MSDRadixSort)
+BENCHMARK_DEFINE_F(SortingBmk_sortedruns, MergeSortedRuns)
 (benchmark::State& state)
 {
-    const auto n = state.range(0);
-
     std::vector<T> values(m_vals.size());
+    perf_counters::scope measure(state, state.range(0));
     for (auto _ : state) {
-        std::copy(m_vals.begin(), m_vals.end(), values.begin());
-
-        radix_sort_msd(values);
+        merge_sorted_runs(m_chunks.data(), m_sizes.data(), m_chunks.size(), values.data(), 1);
         benchmark::DoNotOptimize(values);
         benchmark::ClobberMemory();
     }
 }
-BENCHMARK_REGISTER_F(SortingBmk_descending, MSDRadixSort)->TIME_UNIT->TEST_SIZE;
+BENCHMARK_REGISTER_F(SortingBmk_sortedruns, MergeSortedRuns)->TIME_UNIT->RUNS_SWEEP;
 
-BENCHMARK_DEFINE_F(SortingBmk_descending, HybridRadixSort)
+BENCHMARK_DEFINE_F(SortingBmk_sortedruns, MergeSortedRunsParallel)
 (benchmark::State& state)
 {
-    const auto n = state.range(0);
+    const auto threads = state.range(2);
 
     std::vector<T> values(m_vals.size());
+    perf_counters::scope measure(state, state.range(0));
     for (auto _ : state) {
-        std::copy(m_vals.begin(), m_vals.end(), values.begin());
-
-        radix_sort_hybrid(values);
+        merge_sorted_runs(m_chunks.data(), m_sizes.data(), m_chunks.size(), values.data(), threads);
         benchmark::DoNotOptimize(values);
         benchmark::ClobberMemory();
     }
 }
-BENCHMARK_REGISTER_F(SortingBmk_descending, HybridRadixSort)->TIME_UNIT->TEST_SIZE;
-
-/// 5 unique elements
-///
-class SortingBmk_fewunique : public benchmark::Fixture {
-public:
-    std::vector<T> m_vals;
-
-    void SetUp(const ::benchmark::State& state)
-    {
-        const auto n = state.range(0);
-        m_vals.resize(n);
-
-        std::default_random_engine generator;
-        std::uniform_int_distribution<int> distribution(0, 5);
-
-        T fewUnique[5];
-        std::uniform_int_distribution<T> distributionVal(0, std::numeric_limits<T>::max());
-        for (int j = 0; j < 5; ++j) {
-            fewUnique[j] = distributionVal(generator);
-        }
-
-        for (int i = 0; i < n; ++i) {
-            int j = distribution(generator);
-            m_vals[i] = fewUnique[j];
-        }
-    }
+BENCHMARK_REGISTER_F(SortingBmk_sortedruns, MergeSortedRunsParallel)->TIME_UNIT->RUNS_THREADS_SWEEP;
 
-    void TearDown(const ::benchmark::State& state) { }
-};
-
-BENCHMARK_DEFINE_F(SortingBmk_fewunique, StdStableSort)
+BENCHMARK_DEFINE_F(SortingBmk_sortedruns, HybridRadixSortParallel)
 (benchmark::State& state)
 {
-    BMKBODY(std::stable_sort);
-}
-BENCHMARK_REGISTER_F(SortingBmk_fewunique, StdStableSort)->TIME_UNIT->TEST_SIZE;
-
-BENCHMARK_DEFINE_F(SortingBmk_fewunique, BoostSpreadSort)
-(benchmark::State& state)
-{
-    BMKBODY(boost::sort::spreadsort::spreadsort);
-}
-BENCHMARK_REGISTER_F(SortingBmk_fewunique, BoostSpreadSort)->TIME_UNIT->TEST_SIZE;
-
-BENCHMARK_DEFINE_F(SortingBmk_fewunique, LSDRadixSort)
-(benchmark::State& state)
-{
-    // it is custom due to buffer
-    const auto n = state.range(0);
-
-    std::vector<T> values(m_vals.size());
-    for (auto _ : state) {
-        std::copy(m_vals.begin(), m_vals.end(), values.begin());
-
-        radix_sort_lsd_travis(&values.front(), values.size());
-        benchmark::DoNotOptimize(values);
-        benchmark::ClobberMemory();
-    }
-}
-BENCHMARK_REGISTER_F(SortingBmk_fewunique, LSDRadixSort)->TIME_UNIT->TEST_SIZE;
-
-BENCHMARK_DEFINE_F(SortingBmk_fewunique, MSDRadixSort)
-(benchmark::State& state)
-{
-    const auto n = state.range(0);
+    const auto threads = state.range(2);
 
     std::vector<T> values(m_vals.size());
+    perf_counters::scope measure(state, state.range(0));
     for (auto _ : state) {
         std::copy(m_vals.begin(), m_vals.end(), values.begin());
-
-        radix_sort_msd(values);
+        radix_sort_hybrid_parallel(values, threads);
         benchmark::DoNotOptimize(values);
         benchmark::ClobberMemory();
     }
 }
-BENCHMARK_REGISTER_F(SortingBmk_fewunique, MSDRadixSort)->TIME_UNIT->TEST_SIZE;
+BENCHMARK_REGISTER_F(SortingBmk_sortedruns, HybridRadixSortParallel)->TIME_UNIT->RUNS_THREADS_SWEEP;
 
-BENCHMARK_DEFINE_F(SortingBmk_fewunique, HybridRadixSort)
+// the front door, single threaded
+BENCHMARK_DEFINE_F(SortingBmk_sortedruns, RadixSortChunks)
 (benchmark::State& state)
 {
-    const auto n = state.range(0);
-
     std::vector<T> values(m_vals.size());
+    perf_counters::scope measure(state, state.range(0));
     for (auto _ : state) {
-        std::copy(m_vals.begin(), m_vals.end(), values.begin());
-
-        radix_sort_hybrid(values);
+        radix_sort_chunks(m_chunks.data(), m_sizes.data(), m_chunks.size(), values.data(), 1);
         benchmark::DoNotOptimize(values);
         benchmark::ClobberMemory();
     }
 }
-BENCHMARK_REGISTER_F(SortingBmk_fewunique, HybridRadixSort)->TIME_UNIT->TEST_SIZE;
-
-/// sorted array with n/1000 swaped elements
-///
-class SortingBmk_almostsorted : public benchmark::Fixture {
-public:
-    std::vector<T> m_vals;
+BENCHMARK_REGISTER_F(SortingBmk_sortedruns, RadixSortChunks)->TIME_UNIT->RUNS_SWEEP;
 
-    void SetUp(const ::benchmark::State& state)
-    {
-        const auto n = state.range(0);
-        m_vals.resize(n);
-
-        std::default_random_engine generator;
-        std::uniform_int_distribution<T> distributionVal(0, std::numeric_limits<T>::max());
-        for (int i = 0; i < n; ++i) {
-            m_vals[i] = distributionVal(generator);
-        }
-        std::sort(m_vals.begin(), m_vals.end());
+// A string column in the Arrow layout and its shapes: the row which the generator draws next
+struct string_rows {
+    std::vector<int32_t> offsets = { 0 };
+    std::vector<uint8_t> data;
+};
 
-        std::uniform_int_distribution<int> distributionInd(0, n);
-        for (int i = 0; i < n / 1000; ++i) {
-            int j = distributionInd(generator);
-            std::swap(m_vals[2], m_vals[j]);
-        }
-    }
+struct string_distribution {
+    std::string name;
+    std::function<std::string(std::mt19937_64&)> row;
+};
 
-    void TearDown(const ::benchmark::State& state) { }
+// the argsorts of a string column: {name, fn(rows, count, indices, scratch)}
+struct string_algorithm {
+    std::string name;
+    std::function<void(const string_rows&, size_t, uint32_t*, argsort_scratch<uint64_t, uint32_t>&)> run;
 };
 
-BENCHMARK_DEFINE_F(SortingBmk_almostsorted, StdStableSort)
-(benchmark::State& state)
+std::vector<string_distribution> string_distributions()
 {
-    BMKBODY(std::stable_sort);
+    return {
+        // 1 to 32 printable characters
+        { "randomstrings", [](std::mt19937_64& generator) {
+             std::string row(1 + generator() % 32, ' ');
+             for (auto& c : row)
+                 c = (char)(' ' + generator() % 95);
+             return row;
+         } },
+        // a few paths under one host, the first 24 to 33 bytes are shared by many rows
+        { "urls", [](std::mt19937_64& generator) {
+             static const char* paths[] = { "products/", "users/", "search?q=", "static/img/" };
+             return "https://www.example.com/" + std::string(paths[generator() % 4]) + std::to_string(generator() % 1000000);
+         } },
+        // 3 letter codes, as the currencies or the airports: 17576 values, many duplicates
+        { "shortcodes", [](std::mt19937_64& generator) {
+             std::string row(3, 'A');
+             for (auto& c : row)
+                 c = (char)('A' + generator() % 26);
+             return row;
+         } },
+    };
 }
-BENCHMARK_REGISTER_F(SortingBmk_almostsorted, StdStableSort)->TIME_UNIT->TEST_SIZE;
 
-BENCHMARK_DEFINE_F(SortingBmk_almostsorted, BoostSpreadSort)
-(benchmark::State& state)
+std::vector<string_algorithm> string_algorithms()
 {
-    BMKBODY(boost::sort::spreadsort::spreadsort);
+    return {
+        // what Arrow does: a comparison sort of the indices
+        { "StdStableSort", [](const string_rows& rows, size_t count, uint32_t* indices, argsort_scratch<uint64_t, uint32_t>&) {
+             const auto str = [&rows](uint32_t i) {
+                 return std::string_view((const char*)rows.data.data() + rows.offsets[i], rows.offsets[i + 1] - rows.offsets[i]);
+             };
+             std::iota(indices, indices + count, 0);
+             std::stable_sort(indices, indices + count, [&str](uint32_t l, uint32_t r) { return str(l) < str(r); });
+         } },
+        { "RadixArgsortStrings", [](const string_rows& rows, size_t count, uint32_t* indices, argsort_scratch<uint64_t, uint32_t>& scratch) {
+             radix_argsort_strings(string_column<int32_t> { rows.offsets.data(), rows.data.data() }, count, indices, scratch);
+         } },
+    };
 }
-BENCHMARK_REGISTER_F(SortingBmk_almostsorted, BoostSpreadSort)->TIME_UNIT->TEST_SIZE;
 
-BENCHMARK_DEFINE_F(SortingBmk_almostsorted, LSDRadixSort)
-(benchmark::State& state)
+// SortingBmk_strings_<distribution>/<algorithm>
+void register_string_sorts(const std::vector<int64_t>& sizes)
 {
-    // it is custom due to buffer
-    const auto n = state.range(0);
-
-    std::vector<T> values(m_vals.size());
-    for (auto _ : state) {
-        std::copy(m_vals.begin(), m_vals.end(), values.begin());
-
-        radix_sort_lsd_travis(&values.front(), values.size());
-        benchmark::DoNotOptimize(values);
-        benchmark::ClobberMemory();
+    for (const auto& dist : string_distributions()) {
+        for (const auto& algo : string_algorithms()) {
+            const std::string name = "SortingBmk_strings_" + dist.name + "/" + algo.name;
+            auto* bmk = benchmark::RegisterBenchmark(name.c_str(), [algo, dist](benchmark::State& state) {
+                const size_t n = state.range(0);
+                string_rows rows;
+                std::mt19937_64 generator;
+                for (size_t i = 0; i < n; ++i) {
+                    const std::string row = dist.row(generator);
+                    rows.data.insert(rows.data.end(), row.begin(), row.end());
+                    rows.offsets.push_back((int32_t)rows.data.size());
+                }
+                std::vector<uint32_t> indices(n);
+                argsort_scratch<uint64_t, uint32_t> scratch;
+                scratch.reserve(n);
+                perf_counters::scope measure(state, n);
+                for (auto _ : state) {
+                    algo.run(rows, n, indices.data(), scratch);
+                    benchmark::DoNotOptimize(indices.data());
+                    benchmark::ClobberMemory();
+                }
+                state.SetItemsProcessed(state.iterations() * n);
+                state.SetBytesProcessed(state.iterations() * rows.data.size());
+            });
+            bmk->Unit(benchmark::kMillisecond);
+            for (auto n : sizes)
+                bmk->Arg(n);
+        }
     }
 }
-BENCHMARK_REGISTER_F(SortingBmk_almostsorted, LSDRadixSort)->TIME_UNIT->TEST_SIZE;
 
-BENCHMARK_DEFINE_F(SortingBmk_almostsorted, MSDRadixSort)
-(benchmark::State& state)
+// The sorts and the selections on the distributions, see sort_registry.h
+void register_sorts()
 {
-    const auto n = state.range(0);
-
-    std::vector<T> values(m_vals.size());
-    for (auto _ : state) {
-        std::copy(m_vals.begin(), m_vals.end(), values.begin());
-
-        radix_sort_msd(values);
-        benchmark::DoNotOptimize(values);
-        benchmark::ClobberMemory();
-    }
+    using namespace sort_registry;
+    const std::vector<int64_t> testSizes = { 400000 };
+    // the parallel sorts on the inputs much larger than the others as well
+    const std::vector<int64_t> threadsSizes = { 400000, 1 << 24 };
+
+    const std::vector<distribution<T>> dists = {
+        distributions::all_unique<T>("shuffled"),
+        distributions::all_equal<T>(),
+        distributions::ascending<T>(),
+        distributions::descending<T>(),
+        distributions::few_unique<T>(),
+        distributions::almost_sorted<T>(),
+    };
+    const auto all = sort_algorithms<T>();
+    sort_registry::register_sorts(dists, serial(all), testSizes, benchmark::kMillisecond);
+    sort_registry::register_sorts(dists, parallel(all), threadsSizes, benchmark::kMillisecond);
+    sort_registry::register_sorts(dists, selection_algorithms<T>(), testSizes, benchmark::kMillisecond);
+    sort_registry::register_sorts(dists, unique_algorithms<T>(), testSizes, benchmark::kMillisecond);
+    register_string_sorts(testSizes);
+
+    // the 128-bit keys: prices which fit into 64 bits, wide amounts and hashes
+    sort_registry::register_sorts({ distributions::money("prices", 2), distributions::money("amounts", 18) },
+        wide_key_algorithms<decimal128>(), testSizes, benchmark::kMillisecond);
+    sort_registry::register_sorts({ distributions::hashes() }, wide_key_algorithms<uint128>(), testSizes, benchmark::kMillisecond);
 }
-BENCHMARK_REGISTER_F(SortingBmk_almostsorted, MSDRadixSort)->TIME_UNIT->TEST_SIZE;
 
-BENCHMARK_DEFINE_F(SortingBmk_almostsorted, HybridRadixSort)
-(benchmark::State& state)
+int main(int argc, char** argv)
 {
-    const auto n = state.range(0);
-
-    std::vector<T> values(m_vals.size());
-    for (auto _ : state) {
-        std::copy(m_vals.begin(), m_vals.end(), values.begin());
-
-        radix_sort_hybrid(values);
-        benchmark::DoNotOptimize(values);
-        benchmark::ClobberMemory();
-    }
+    register_sorts();
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
 }
-BENCHMARK_REGISTER_F(SortingBmk_almostsorted, HybridRadixSort)->TIME_UNIT->TEST_SIZE;
-
-BENCHMARK_MAIN();
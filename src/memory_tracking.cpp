@@ -0,0 +1,67 @@
+#include "memory_tracking.h"
+
+#include <atomic>
+#include <malloc.h>
+#include <new>
+#include <stdlib.h>
+
+namespace {
+std::atomic<size_t> g_current { 0 };
+std::atomic<size_t> g_peak { 0 };
+std::atomic<size_t> g_base { 0 };
+
+void* track_alloc(void* p)
+{
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    const size_t size = malloc_usable_size(p);
+    const size_t current = g_current.fetch_add(size, std::memory_order_relaxed) + size;
+    size_t peak = g_peak.load(std::memory_order_relaxed);
+    while (current > peak && !g_peak.compare_exchange_weak(peak, current, std::memory_order_relaxed)) {
+    }
+    return p;
+}
+
+void track_free(void* p)
+{
+    if (p != nullptr) {
+        g_current.fetch_sub(malloc_usable_size(p), std::memory_order_relaxed);
+        free(p);
+    }
+}
+
+void* aligned(size_t size, std::align_val_t align)
+{
+    const size_t alignment = static_cast<size_t>(align);
+    return aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+}
+
+namespace memory_tracking {
+size_t current_bytes() { return g_current.load(std::memory_order_relaxed); }
+
+void reset_peak()
+{
+    g_base = current_bytes();
+    g_peak = g_base.load();
+}
+
+size_t peak_bytes() { return g_peak.load(std::memory_order_relaxed) - g_base.load(std::memory_order_relaxed); }
+
+benchmark::Counter peak_counter() { return benchmark::Counter(peak_bytes(), benchmark::Counter::kDefaults, benchmark::Counter::kIs1024); }
+}
+
+void* operator new(size_t size) { return track_alloc(malloc(size)); }
+void* operator new[](size_t size) { return track_alloc(malloc(size)); }
+void* operator new(size_t size, std::align_val_t align) { return track_alloc(aligned(size, align)); }
+void* operator new[](size_t size, std::align_val_t align) { return track_alloc(aligned(size, align)); }
+
+void operator delete(void* p) noexcept { track_free(p); }
+void operator delete[](void* p) noexcept { track_free(p); }
+void operator delete(void* p, size_t) noexcept { track_free(p); }
+void operator delete[](void* p, size_t) noexcept { track_free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { track_free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { track_free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { track_free(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { track_free(p); }
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include <stddef.h>
+
+/**
+ * Heap usage of the benchmarks, counted by the replacement operator new/delete of
+ * memory_tracking.cpp, so that the sorts which trade the O(n) buffer for time can be compared
+ * by both.
+ */
+namespace memory_tracking {
+size_t current_bytes();
+
+// restarts the peak at the current usage
+void reset_peak();
+
+// the peak usage since reset_peak() above the usage at that point: the buffers of the sorts when
+// it is reset after the input is allocated
+size_t peak_bytes();
+
+benchmark::Counter peak_counter();
+}
@@ -0,0 +1,113 @@
+#include "perf_counters.h"
+#include "memory_tracking.h"
+
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+struct event {
+    const char* name;
+    uint32_t type;
+    uint64_t config;
+};
+
+const event g_events[] = {
+    { "instr_per_elem", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { "llc_miss_per_elem", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { "dtlb_miss_per_elem", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+    { "br_miss_per_elem", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+};
+const size_t NUM_EVENTS = sizeof(g_events) / sizeof(g_events[0]);
+
+// what read(2) returns with PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING
+struct reading {
+    uint64_t value;
+    uint64_t enabled;
+    uint64_t running;
+};
+
+int open_event(const event& e)
+{
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = e.type;
+    attr.config = e.config;
+    // the times scale the counts when the events outnumber the hardware counters
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // the threads started later count into this one, the groups can't be read with inherit
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+// Opened once, by the benchmark thread, and never reset: the counts of the exited threads stay in
+// the event whatever PERF_EVENT_IOC_RESET does, so start() keeps the readings and report()
+// subtracts them.
+struct counters {
+    int fds[NUM_EVENTS];
+    reading started[NUM_EVENTS];
+
+    counters()
+    {
+        for (size_t i = 0; i < NUM_EVENTS; ++i)
+            fds[i] = open_event(g_events[i]);
+    }
+
+    bool read_event(size_t i, reading& r) const
+    {
+        return fds[i] >= 0 && ::read(fds[i], &r, sizeof(r)) == (ssize_t)sizeof(r);
+    }
+};
+
+counters& instance()
+{
+    static counters c;
+    return c;
+}
+}
+
+namespace perf_counters {
+void start()
+{
+    counters& c = instance();
+    for (size_t i = 0; i < NUM_EVENTS; ++i) {
+        if (!c.read_event(i, c.started[i]))
+            c.started[i] = {};
+    }
+}
+
+void report(benchmark::State& state, size_t itemsPerIteration)
+{
+    const counters& c = instance();
+    const double items = (double)state.iterations() * itemsPerIteration;
+    for (size_t i = 0; i < NUM_EVENTS; ++i) {
+        reading r;
+        if (items == 0 || !c.read_event(i, r))
+            continue;
+        const uint64_t running = r.running - c.started[i].running;
+        if (running == 0)
+            continue; // never scheduled on a hardware counter
+        const double value = (double)(r.value - c.started[i].value) * (r.enabled - c.started[i].enabled) / running;
+        state.counters[g_events[i].name] = value / items;
+    }
+}
+
+scope::scope(benchmark::State& state, size_t itemsPerIteration)
+    : m_state(state)
+    , m_itemsPerIteration(itemsPerIteration)
+{
+    memory_tracking::reset_peak();
+    start();
+}
+
+scope::~scope()
+{
+    m_state.counters["peak_mem"] = memory_tracking::peak_counter();
+    report(m_state, m_itemsPerIteration);
+}
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include <stddef.h>
+
+/**
+ * Hardware counters of the timed loops, read through perf_event_open(2) by perf_counters.cpp, so
+ * that the scatter locality of the sorts shows in every run next to the time: the last level
+ * cache misses, the data TLB misses, the branch misses and the instructions, per element.
+ *
+ * The counters follow the calling thread and the threads it starts, the workers of the parallel
+ * sorts. A counter which can't be opened, with no PMU in a virtual machine or a too restrictive
+ * kernel.perf_event_paranoid, is left out of the report and the benchmarks run the same.
+ */
+namespace perf_counters {
+// starts counting from the current values, before the timed loop
+void start();
+
+// adds the counts since start() divided by iterations * itemsPerIteration to the counters of
+// state, after the timed loop
+void report(benchmark::State& state, size_t itemsPerIteration);
+
+// The measurements of a benchmark around its timed loop: constructed right before it, restarts
+// the peak of memory_tracking.h and the counters, and reports peak_mem and the counters when it
+// goes out of scope after the loop.
+class scope {
+public:
+    scope(benchmark::State& state, size_t itemsPerIteration);
+    scope(const scope&) = delete;
+    scope& operator=(const scope&) = delete;
+    ~scope();
+
+private:
+    benchmark::State& m_state;
+    size_t m_itemsPerIteration;
+};
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <stdint.h>
+#include <type_traits>
+
+#include "radix_histogram.h"
+#include "radix_key.h"
+
+/**
+ * Counting sort of the 8- and 16-bit integer keys, which the radix sorts take instead of their
+ * passes: a single histogram of all the 256 or 65536 values, then the output is written from the
+ * counts. Equal integers are indistinguishable, so nothing is moved at all: no scatter, no scratch,
+ * one read and one write pass, and the sort is trivially stable.
+ */
+template <class T>
+constexpr bool is_counting_sortable() { return std::is_integral<T>::value && sizeof(T) <= 2; }
+
+namespace counting_impl {
+// writes freq[k] copies of the key k for all the keys in order, returns the end of the output
+template <class T, class Counter>
+T* write_counts(const Counter* freq, T* dst)
+{
+    using K = radix_key_t<T>;
+    constexpr size_t SIZE = (size_t)1 << (sizeof(K) * 8);
+    for (size_t k = 0; k < SIZE; k++) {
+        dst = std::fill_n(dst, freq[k], radix_key_traits<T>::value((K)k));
+    }
+    return dst;
+}
+
+// Counter is uint32_t unless count needs more, half the footprint of the 256K histogram of 16-bit keys
+template <class Counter, class T>
+void counting_sort_wide(const T* src, size_t count, T* dst)
+{
+    constexpr size_t SIZE = (size_t)1 << (sizeof(T) * 8);
+    std::unique_ptr<Counter[]> freq(new Counter[SIZE]());
+    for (size_t i = 0; i < count; i++) {
+        freq[radix_key(src[i])]++;
+    }
+    write_counts(freq.get(), dst);
+}
+}
+
+/**
+ * Sorts src[0, count) into dst[0, count), src == dst sorts in place. Below SIZE / 8 keys walking
+ * the histogram costs more than std::sort.
+ */
+template <class T>
+void counting_sort(const T* src, size_t count, T* dst)
+{
+    static_assert(is_counting_sortable<T>(), "only the 8- and 16-bit integers are counting sorted");
+    constexpr size_t SIZE = (size_t)1 << (sizeof(T) * 8);
+    if (count < SIZE / 8) {
+        if (src != dst) {
+            std::copy(src, src + count, dst);
+        }
+        std::sort(dst, dst + count, radix_less());
+        return;
+    }
+
+    if constexpr (sizeof(T) == 1) {
+        // all the duplicates: the sub-histograms of count_digit break the chains of increments
+        size_t freq[SIZE];
+        count_digit<8>(src, count, 0, freq);
+        counting_impl::write_counts(freq, dst);
+    } else if (count <= UINT32_MAX) {
+        counting_impl::counting_sort_wide<uint32_t>(src, count, dst);
+    } else {
+        counting_impl::counting_sort_wide<size_t>(src, count, dst);
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+
+#include "radix_key.h"
+
+/**
+ * Everything the radix sorts derive from the digit width RADIX_BITS.
+ *
+ * Wider digits mean fewer passes over the data but larger histograms: 8-bit digits take 8 passes
+ * over 64-bit keys, 11-bit digits take 6 (4-5 for 40-48 bit keys) with 2048 buckets which still
+ * fit into L1/L2, 16-bit digits take 4 but their 65536 buckets spill into L2/L3.
+ */
+template <size_t BITS>
+struct radix_digits {
+    static_assert(BITS >= 1 && BITS <= 16, "digit width must be in [1, 16] bits");
+
+    static constexpr size_t RADIX_BITS = BITS;
+    static constexpr size_t RADIX_SIZE = (size_t)1 << RADIX_BITS;
+    static constexpr size_t RADIX_MASK = RADIX_SIZE - 1;
+    // the digits of a 64-bit key, see levels() for the narrower ones
+    static constexpr size_t RADIX_LEVELS = (63 / RADIX_BITS) + 1;
+
+    // the digits of the keys of T: the passes, and the histograms, of a uint32_t column are half
+    // of the ones of a uint64_t column
+    template <class T>
+    static constexpr size_t levels() { return (sizeof(radix_key_t<T>) * 8 + RADIX_BITS - 1) / RADIX_BITS; }
+
+    // the highest digit which has one of the `varying` bits, the first pass an MSD sort needs
+    template <class T>
+    static size_t top_level(T varying)
+    {
+        assert(varying != 0);
+        if constexpr (sizeof(T) > 8) {
+            const auto high = (unsigned long long)(varying >> 64);
+            if (high != 0)
+                return (127 - __builtin_clzll(high)) / RADIX_BITS;
+        }
+        return (63 - __builtin_clzll((unsigned long long)varying)) / RADIX_BITS;
+    }
+};
+
+/**
+ * The bits which differ between the radix_keys of a[0, count), 0 if there are less than two distinct keys.
+ *
+ * The bits above the highest varying bit are the prefix common to all the keys, so the MSD sorts
+ * can start at the digit of that bit instead of paying a histogram pass per constant digit to find
+ * it. OR and AND of all the keys is a single pass which the compiler vectorizes.
+ */
+template <class T>
+radix_key_t<T> varying_bits(const T* a, size_t count)
+{
+    using K = radix_key_t<T>;
+    if (count == 0) {
+        return 0;
+    }
+    K orAll = 0, andAll = ~(K)0;
+    for (size_t i = 0; i < count; i++) {
+        orAll |= radix_key(a[i]);
+        andAll &= radix_key(a[i]);
+    }
+    return orAll ^ andAll;
+}
+
+/**
+ * Elements of scratch the radix sorts need for `count` keys of T: the size of the `queue_area` of
+ * radix_sort_lsd_travis, the std::vector scratch of radix_sort_hybrid and radix_sort_msd is grown
+ * to it. Keeping the scratch between the calls saves the allocation, zeroing and page faults of
+ * a fresh buffer on every call.
+ */
+template <class T>
+constexpr size_t radix_sort_scratch_size(size_t count) { return count; }
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+#include <utility>
+
+#include "radix_key.h"
+
+/**
+ * Histogram kernels of the radix sorts.
+ *
+ * The naive loop does `freq[digit]++` for every element, so on skewed data (few unique values,
+ * all equal) consecutive increments hit the same counter and every one of them waits for the
+ * store-to-load forwarding of the previous one. The kernels below spread the consecutive elements
+ * over sub_histograms() interleaved sub-histograms which are reduced at the end, so that the
+ * increments of the same counter form independent chains.
+ *
+ * Extracting the digits with AVX2/AVX-512 (a vector store of the keys read back byte by byte) was
+ * tried and lost to the scalar kernel: the increments, not the shifts, are the bottleneck and the
+ * byte loads can't be forwarded from the wide store.
+ */
+namespace histogram_impl {
+// sub-histograms of the wide digits wouldn't fit into the caches
+template <size_t RADIX_BITS>
+constexpr size_t sub_histograms() { return RADIX_BITS <= 8 ? 4 : 1; }
+
+// the sub-histograms of both kernels use 32-bit counters to halve their footprint, so they are
+// reduced every BLOCK elements before they could overflow
+const size_t BLOCK = size_t(1) << 31;
+
+// sub[s][pass] is the histogram of the digit `pass` of the elements i with i % SUB == s,
+// HI is the number of digits counted, a constant so that the loops over the digits unroll
+template <size_t RADIX_BITS, size_t LEVELS, size_t HI, class T>
+inline void count_scalar(const T* a, size_t count, uint32_t (*sub)[LEVELS][1 << RADIX_BITS])
+{
+    using K = radix_key_t<T>;
+    constexpr size_t SUB = sub_histograms<RADIX_BITS>();
+    constexpr size_t RADIX_MASK = ((size_t)1 << RADIX_BITS) - 1;
+    size_t i = 0;
+    for (; i + SUB <= count; i += SUB) {
+        for (size_t s = 0; s < SUB; s++) {
+            K value = radix_key(a[i + s]);
+            for (size_t pass = 0; pass < HI; pass++) {
+                sub[s][pass][value & RADIX_MASK]++;
+                value >>= RADIX_BITS;
+            }
+        }
+    }
+    for (; i < count; i++) {
+        K value = radix_key(a[i]);
+        for (size_t pass = 0; pass < HI; pass++) {
+            sub[0][pass][value & RADIX_MASK]++;
+            value >>= RADIX_BITS;
+        }
+    }
+}
+
+// turns the runtime number of digits into the template parameter HI
+template <size_t RADIX_BITS, size_t LEVELS, class T, size_t... HI>
+void count_block(const T* a, size_t count, uint32_t (*sub)[LEVELS][1 << RADIX_BITS], size_t hiPass, std::index_sequence<HI...>)
+{
+    using kernel_type = void (*)(const T*, size_t, uint32_t(*)[LEVELS][1 << RADIX_BITS]);
+    static constexpr kernel_type kernels[] = { &count_scalar<RADIX_BITS, LEVELS, HI + 1, T>... };
+    kernels[hiPass - 1](a, count, sub);
+}
+}
+
+/**
+ * Adds the histograms of the digits [0, hiPass) of a[0, count) to freqs, 0 < hiPass <= LEVELS.
+ */
+template <size_t RADIX_BITS, size_t LEVELS, class T>
+void count_digits(const T* a, size_t count, size_t (*freqs)[1 << RADIX_BITS], size_t hiPass)
+{
+    using namespace histogram_impl;
+    constexpr size_t RADIX_SIZE = (size_t)1 << RADIX_BITS;
+    constexpr size_t SUB = sub_histograms<RADIX_BITS>();
+    using sub_array_type = uint32_t[SUB][LEVELS][RADIX_SIZE];
+
+    auto count_blocks = [&](sub_array_type& sub) {
+        for (size_t block = 0; block < count; block += BLOCK) {
+            const size_t n = std::min(BLOCK, count - block);
+            for (size_t s = 0; s < SUB; s++) {
+                memset(sub[s], 0, hiPass * sizeof(sub[s][0]));
+            }
+            count_block<RADIX_BITS, LEVELS>(a + block, n, sub, hiPass, std::make_index_sequence<LEVELS>());
+
+            for (size_t s = 0; s < SUB; s++) {
+                for (size_t pass = 0; pass < hiPass; pass++) {
+                    for (size_t i = 0; i < RADIX_SIZE; i++) {
+                        freqs[pass][i] += sub[s][pass][i];
+                    }
+                }
+            }
+        }
+    };
+
+    // 32K for the 8 levels of 8-bit digits, the wide digits go to the heap
+    if constexpr (sizeof(sub_array_type) <= (64 << 10)) {
+        alignas(64) sub_array_type sub;
+        count_blocks(sub);
+    } else {
+        std::unique_ptr<sub_array_type[]> sub(new sub_array_type[1]);
+        count_blocks(sub[0]);
+    }
+}
+
+/**
+ * Histogram of the single digit radix_digit(value, shift) of a[0, count), the per-node
+ * histogram of the MSD sorts. Overwrites freq.
+ */
+template <size_t RADIX_BITS, class T>
+void count_digit(const T* a, size_t count, size_t shift, size_t freq[1 << RADIX_BITS])
+{
+    constexpr size_t RADIX_SIZE = (size_t)1 << RADIX_BITS;
+    constexpr size_t SUB = histogram_impl::sub_histograms<RADIX_BITS>();
+
+    std::fill(freq, freq + RADIX_SIZE, 0);
+    if (count < SUB * RADIX_SIZE) {
+        // zeroing and reducing the sub-histograms would cost more than the stalls they save
+        for (size_t i = 0; i < count; i++) {
+            freq[radix_digit<RADIX_BITS>(a[i], shift)]++;
+        }
+        return;
+    }
+
+    // 32-bit counters as in count_digits, 4K for the 4 sub-histograms of the 8-bit digits
+    alignas(64) uint32_t sub[SUB][RADIX_SIZE];
+    for (size_t block = 0; block < count; block += histogram_impl::BLOCK) {
+        const T* b = a + block;
+        const size_t n = std::min(histogram_impl::BLOCK, count - block);
+        memset(sub, 0, sizeof(sub));
+        size_t i = 0;
+        for (; i + SUB <= n; i += SUB) {
+            for (size_t s = 0; s < SUB; s++) {
+                sub[s][radix_digit<RADIX_BITS>(b[i + s], shift)]++;
+            }
+        }
+        for (; i < n; i++) {
+            sub[0][radix_digit<RADIX_BITS>(b[i], shift)]++;
+        }
+        for (size_t d = 0; d < RADIX_SIZE; d++) {
+            size_t total = 0;
+            for (size_t s = 0; s < SUB; s++) {
+                total += sub[s][d];
+            }
+            freq[d] += total;
+        }
+    }
+}
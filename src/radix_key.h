@@ -0,0 +1,117 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+/**
+ * The radix sorts see every key through radix_key: an unsigned integer whose order is the order
+ * of the keys, so that the digits can be taken by shifts and masks. It is applied where the
+ * histograms and the scatters read the digits, not as a separate pass over the data.
+ *
+ * - unsigned integers are their own keys
+ * - signed integers flip the sign bit, which moves the negative ones below the positive ones
+ * - floats and doubles flip the sign bit of the positive values and all the bits of the negative
+ *   ones, whose magnitude order is reversed. This is the IEEE 754 totalOrder:
+ *   -NaN < -inf < ... < -0.0 < +0.0 < ... < +inf < +NaN, so -0.0 sorts before +0.0 and the NaNs
+ *   go to the ends by their sign bit instead of breaking the order.
+ * - the 128-bit keys, decimal128 and uint128 below, are joined into a 128-bit integer, the sign
+ *   bit of decimal128 flipped as for the signed integers. The compiler keeps it in two registers
+ *   and splits the shifts of the digits over the words.
+ *
+ * Every comparison the sorts make (small sorts, presorted runs, merges) uses radix_less, the same
+ * order, which is operator< for the integers.
+ */
+template <class T, class Enable = void>
+struct radix_key_traits;
+
+template <class T>
+struct radix_key_traits<T, std::enable_if_t<std::is_integral<T>::value && std::is_unsigned<T>::value>> {
+    using key_type = T;
+    static key_type key(T value) { return value; }
+    static T value(key_type key) { return key; }
+};
+
+template <class T>
+struct radix_key_traits<T, std::enable_if_t<std::is_integral<T>::value && std::is_signed<T>::value>> {
+    using key_type = std::make_unsigned_t<T>;
+    static key_type key(T value) { return (key_type)value ^ ((key_type)1 << (sizeof(T) * 8 - 1)); }
+    static T value(key_type key) { return (T)(key_type)(key ^ ((key_type)1 << (sizeof(T) * 8 - 1))); }
+};
+
+template <class T>
+struct radix_key_traits<T, std::enable_if_t<std::is_floating_point<T>::value>> {
+    static_assert(sizeof(T) == 4 || sizeof(T) == 8, "only float and double are supported");
+    using key_type = std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>;
+    using signed_type = std::make_signed_t<key_type>;
+
+    static key_type key(T value)
+    {
+        key_type bits;
+        memcpy(&bits, &value, sizeof(bits));
+        // all ones for the negative values, the sign bit alone for the positive ones
+        const key_type mask = (key_type)((signed_type)bits >> (sizeof(T) * 8 - 1)) | ((key_type)1 << (sizeof(T) * 8 - 1));
+        return bits ^ mask;
+    }
+
+    static T value(key_type key)
+    {
+        // the sign bit is set for the positive values, cleared for the flipped negative ones
+        const key_type bits = (key >> (sizeof(T) * 8 - 1)) ? key ^ ((key_type)1 << (sizeof(T) * 8 - 1)) : ~key;
+        T result;
+        memcpy(&result, &bits, sizeof(result));
+        return result;
+    }
+};
+
+__extension__ typedef unsigned __int128 radix_uint128_t;
+
+// Arrow's decimal128: a 128-bit two's complement integer, the unscaled value of the decimal, as
+// two words, the low one first as Arrow lays it out on the little endian machines. The decimals of
+// a column share their scale, so their order is the one of the integers.
+struct decimal128 {
+    uint64_t lo;
+    int64_t hi;
+};
+
+// the unsigned 128-bit keys, the hashes
+struct uint128 {
+    uint64_t lo;
+    uint64_t hi;
+};
+
+template <class T>
+struct radix_key_traits<T, std::enable_if_t<std::is_same<T, decimal128>::value || std::is_same<T, uint128>::value>> {
+    using key_type = radix_uint128_t;
+    static constexpr key_type SIGN = std::is_same<T, decimal128>::value ? (key_type)1 << 127 : 0;
+
+    static key_type key(T value) { return (((key_type)(uint64_t)value.hi << 64) | value.lo) ^ SIGN; }
+    static T value(key_type key)
+    {
+        key ^= SIGN;
+        return { (uint64_t)key, (decltype(T::hi))(uint64_t)(key >> 64) };
+    }
+};
+
+template <class T>
+using radix_key_t = typename radix_key_traits<T>::key_type;
+
+// the 128-bit keys: the sorts which can't take them check it
+template <class T>
+constexpr bool is_wide_key() { return sizeof(radix_key_t<T>) > 8; }
+
+template <class T>
+inline radix_key_t<T> radix_key(T value) { return radix_key_traits<T>::key(value); }
+
+// the digit of RADIX_BITS bits at `shift` of the key of value
+template <size_t RADIX_BITS, class T>
+inline size_t radix_digit(T value, size_t shift)
+{
+    return (radix_key(value) >> shift) & (((size_t)1 << RADIX_BITS) - 1);
+}
+
+// the order of the radix sorts, see radix_key_traits
+struct radix_less {
+    template <class T>
+    bool operator()(T left, T right) const { return radix_key(left) < radix_key(right); }
+};
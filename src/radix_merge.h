@@ -0,0 +1,237 @@
+#pragma once
+
+#include <algorithm>
+#include <assert.h>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "radix_key.h"
+#include "radix_presorted.h"
+#include "radix_sort_hybrid.h"
+#include "work_stealing_pool.h"
+
+/**
+ * Chunked columns, an array of sorted chunks (per file, per partition) whose concatenation is
+ * to be sorted. Merging the chunks keeps their order and costs a single pass, which wins over
+ * the radix passes of the concatenation while the log2(numChunks) comparisons of a loser tree
+ * stay cheap. The merge is stable: the equal keys come in the order of the chunks.
+ */
+namespace merge_impl {
+// below this many keys per thread the splits and the tasks cost more than they save
+const size_t PARALLEL_MERGE_THRESHOLD = 1 << 16;
+// The merge of up to MAX_MERGE_CHUNKS chunks beats the radix sort once the input is too large for
+// the caches, MERGE_MIN_COUNT keys, where the scatter of the radix passes gets expensive. The
+// loser tree gets a level deeper every time the chunks double. See SortingBmk_sortedruns of
+// diffdistrib_bmk. Two chunks are always merged, a single std::merge pass.
+const size_t MAX_MERGE_CHUNKS = 32;
+const size_t MERGE_MIN_COUNT = 1 << 22;
+
+/**
+ * Tournament tree of the heads of numRuns runs, whose inner nodes keep the loser of the match
+ * played there and node 0 the overall winner. Popping the winner replays only the matches on the
+ * path of its run, log2(numRuns) comparisons against the losers which are already known.
+ *
+ * The nodes hold the keys, so the matches don't chase the run pointers. A node orders by its key
+ * and then its run, which makes the ties go to the earlier run; an exhausted run is the maximal
+ * key with its run moved past all the others, so it loses to everything without a check.
+ */
+template <class T>
+class loser_tree {
+    using K = radix_key_t<T>;
+    struct node {
+        K key;
+        size_t order; // the run, plus m_leaves once it is exhausted
+
+        bool operator<(const node& other) const { return key < other.key || (key == other.key && order < other.order); }
+    };
+
+public:
+    loser_tree(const T* const* begins, const T* const* ends, size_t numRuns)
+    {
+        m_leaves = 1;
+        while (m_leaves < numRuns)
+            m_leaves *= 2;
+        m_cur.assign(m_leaves, nullptr);
+        m_end.assign(m_leaves, nullptr);
+        std::copy(begins, begins + numRuns, m_cur.begin());
+        std::copy(ends, ends + numRuns, m_end.begin());
+
+        // the winners of the subtrees, bottom-up, the leaves at [m_leaves, 2 * m_leaves)
+        m_tree.resize(m_leaves);
+        std::vector<node> winners(2 * m_leaves);
+        for (size_t i = 0; i < m_leaves; ++i)
+            winners[m_leaves + i] = head(i);
+        for (size_t i = m_leaves - 1; i != 0; --i) {
+            const node l = winners[2 * i], r = winners[2 * i + 1];
+            winners[i] = r < l ? r : l;
+            m_tree[i] = r < l ? l : r;
+        }
+        m_tree[0] = winners[1];
+    }
+
+    // writes the next element in the merged order to out
+    void pop(T* out)
+    {
+        const size_t run = m_tree[0].order;
+        *out = *m_cur[run]++;
+        node winner = head(run);
+        for (size_t i = (m_leaves + run) / 2; i != 0; i /= 2) {
+            // the compiler turns the exchange into conditional moves
+            const node loser = m_tree[i];
+            const bool swap = loser < winner;
+            m_tree[i] = swap ? winner : loser;
+            winner = swap ? loser : winner;
+        }
+        m_tree[0] = winner;
+    }
+
+private:
+    node head(size_t run) const
+    {
+        return m_cur[run] != m_end[run] ? node { radix_key(*m_cur[run]), run } : node { ~(K)0, m_leaves + run };
+    }
+
+    size_t m_leaves;
+    std::vector<const T*> m_cur, m_end;
+    std::vector<node> m_tree;
+};
+
+// Merges the runs [begins[i], ends[i]) to out, which receives the sum of their sizes.
+template <class T>
+void merge_runs_serial(const T* const* begins, const T* const* ends, size_t numRuns, T* out)
+{
+    size_t count = 0;
+    std::vector<const T*> b, e;
+    for (size_t i = 0; i < numRuns; ++i) {
+        // the empty runs would only cost comparisons
+        if (begins[i] != ends[i]) {
+            b.push_back(begins[i]);
+            e.push_back(ends[i]);
+            count += ends[i] - begins[i];
+        }
+    }
+    if (b.size() <= 1) {
+        if (!b.empty())
+            std::copy(b[0], e[0], out);
+        return;
+    }
+    if (b.size() == 2) {
+        std::merge(b[0], e[0], b[1], e[1], out, radix_less());
+        return;
+    }
+    loser_tree<T> tree(b.data(), e.data(), b.size());
+    for (size_t i = 0; i < count; ++i)
+        tree.pop(out + i);
+}
+
+/**
+ * The split of the runs at `rank` of their stable merge (multiway merge path): split[i] elements
+ * of the run i are among the first `rank` ones. The key of the element of rank `rank` is found by
+ * a binary search over the keys, counting the smaller ones in every run by binary searches, then
+ * the runs give their equal keys in order until the rank is reached. rank < the sum of the sizes.
+ */
+template <class T>
+void split_runs(const T* const* runs, const size_t* sizes, size_t numRuns, size_t rank, size_t* split)
+{
+    using K = radix_key_t<T>;
+    auto countNotGreater = [&](K key) {
+        size_t n = 0;
+        for (size_t i = 0; i < numRuns; ++i)
+            n += std::upper_bound(runs[i], runs[i] + sizes[i], key, [](K k, T v) { return k < radix_key(v); }) - runs[i];
+        return n;
+    };
+    K lo = 0, hi = ~(K)0;
+    while (lo < hi) {
+        const K mid = lo + (hi - lo) / 2;
+        if (countNotGreater(mid) > rank)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+
+    size_t remaining = rank;
+    for (size_t i = 0; i < numRuns; ++i) {
+        split[i] = std::lower_bound(runs[i], runs[i] + sizes[i], lo, [](T v, K k) { return radix_key(v) < k; }) - runs[i];
+        remaining -= split[i];
+    }
+    for (size_t i = 0; i < numRuns && remaining != 0; ++i) {
+        const size_t equal = std::upper_bound(runs[i] + split[i], runs[i] + sizes[i], lo, [](K k, T v) { return k < radix_key(v); }) - runs[i] - split[i];
+        const size_t take = std::min(equal, remaining);
+        split[i] += take;
+        remaining -= take;
+    }
+}
+}
+
+/**
+ * Stable merge of the sorted runs runs[i][0, sizes[i]) into out, which has room for the sum of
+ * the sizes and doesn't overlap them. The output is cut into numThreads parts at equal ranks,
+ * split_runs finds where every run crosses the cuts, and the parts are merged independently by
+ * loser trees on a work-stealing pool.
+ */
+template <class T>
+void merge_sorted_runs(const T* const* runs, const size_t* sizes, size_t numRuns, T* out,
+    size_t numThreads = std::thread::hardware_concurrency())
+{
+    size_t count = 0;
+    for (size_t i = 0; i < numRuns; ++i)
+        count += sizes[i];
+    const size_t numParts = std::max<size_t>(1, std::min(numThreads, count / merge_impl::PARALLEL_MERGE_THRESHOLD));
+
+    // the cuts of the runs: splits[p * numRuns + i] elements of the run i go before the part p
+    std::vector<size_t> splits((numParts + 1) * numRuns);
+    std::copy(sizes, sizes + numRuns, splits.begin() + numParts * numRuns);
+    for (size_t p = 1; p < numParts; ++p)
+        merge_impl::split_runs(runs, sizes, numRuns, count * p / numParts, splits.data() + p * numRuns);
+
+    auto mergePart = [&](size_t p) {
+        std::vector<const T*> begins(numRuns), ends(numRuns);
+        size_t offset = 0;
+        for (size_t i = 0; i < numRuns; ++i) {
+            begins[i] = runs[i] + splits[p * numRuns + i];
+            ends[i] = runs[i] + splits[(p + 1) * numRuns + i];
+            offset += splits[p * numRuns + i];
+        }
+        merge_impl::merge_runs_serial(begins.data(), ends.data(), numRuns, out + offset);
+    };
+    if (numParts == 1) {
+        mergePart(0);
+        return;
+    }
+    work_stealing_pool pool(numThreads);
+    task_group group;
+    for (size_t p = 0; p < numParts; ++p)
+        pool.submit(group, [&mergePart, p] { mergePart(p); });
+    pool.wait(group);
+}
+
+/**
+ * Sorts the concatenation of the chunks chunks[i][0, sizes[i]) into out, stable. Sorted chunks
+ * are merged by merge_sorted_runs when their number and size say it is faster, see
+ * MAX_MERGE_CHUNKS, anything else is copied and radix sorted. The pass which checks that the
+ * chunks are sorted is cheap next to either.
+ */
+template <size_t RADIX_BITS = 8, class T>
+void radix_sort_chunks(const T* const* chunks, const size_t* sizes, size_t numChunks, T* out,
+    size_t numThreads = std::thread::hardware_concurrency())
+{
+    size_t count = 0;
+    for (size_t i = 0; i < numChunks; ++i)
+        count += sizes[i];
+    bool merge = numChunks <= 2 || (numChunks <= merge_impl::MAX_MERGE_CHUNKS && count >= merge_impl::MERGE_MIN_COUNT);
+    for (size_t i = 0; i < numChunks && merge; ++i)
+        merge = scan_keys(chunks[i], 0, sizes[i]).descents == 0;
+    if (merge) {
+        merge_sorted_runs(chunks, sizes, numChunks, out, numThreads);
+        return;
+    }
+
+    count = 0;
+    for (size_t i = 0; i < numChunks; ++i)
+        count = std::copy(chunks[i], chunks[i] + sizes[i], out + count) - out;
+    if (numThreads > 1)
+        radix_sort_hybrid_parallel<RADIX_BITS>(out, count, numThreads);
+    else
+        radix_sort_hybrid<RADIX_BITS>(out, count);
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "radix_presorted.h"
+
+/**
+ * Nullable columns in the Arrow layout: the validity bitmap has bit i (least significant bit
+ * first, bit i % 8 of byte i / 8) set when the slot i holds a value and cleared when it is null.
+ * The values of the null slots are garbage, they are never compared. An array with an offset
+ * passes the bitmap and the values of its first element, the offset has to be a multiple of 8.
+ */
+enum class null_placement {
+    at_start,
+    at_end,
+};
+
+inline bool is_valid(const uint8_t* validity, size_t i) { return (validity[i >> 3] >> (i & 7)) & 1; }
+
+// sets the bits [lo, hi) of the bitmap to `valid`, the bits outside are kept
+inline void set_validity(uint8_t* validity, size_t lo, size_t hi, bool valid)
+{
+    for (; lo < hi && (lo & 7) != 0; ++lo) {
+        validity[lo >> 3] = valid ? validity[lo >> 3] | (1 << (lo & 7)) : validity[lo >> 3] & ~(1 << (lo & 7));
+    }
+    const size_t bytesEnd = hi & ~(size_t)7;
+    if (lo < bytesEnd) {
+        memset(validity + (lo >> 3), valid ? 0xFF : 0, (bytesEnd - lo) >> 3);
+        lo = bytesEnd;
+    }
+    for (; lo < hi; ++lo) {
+        validity[lo >> 3] = valid ? validity[lo >> 3] | (1 << (lo & 7)) : validity[lo >> 3] & ~(1 << (lo & 7));
+    }
+}
+
+// where the nulls and the values of a sorted column of count slots with nullCount nulls go
+struct null_layout {
+    size_t nullCount;
+    size_t nullsBegin; // [nullsBegin, nullsBegin + nullCount) are the nulls
+    size_t validBegin; // [validBegin, validBegin + count - nullCount) are the values
+
+    null_layout(size_t count, size_t nullCount, null_placement placement)
+        : nullCount(nullCount)
+        , nullsBegin(placement == null_placement::at_start ? 0 : count - nullCount)
+        , validBegin(placement == null_placement::at_start ? nullCount : 0)
+    {
+    }
+
+    // rewrites the bitmap of the sorted column
+    void write(uint8_t* validity, size_t count) const
+    {
+        set_validity(validity, nullsBegin, nullsBegin + nullCount, false);
+        set_validity(validity, validBegin, validBegin + count - nullCount, true);
+    }
+};
+
+// the cleared bits of validity[0, count), a popcount over count / 8 bytes
+inline size_t count_nulls(const uint8_t* validity, size_t count)
+{
+    size_t valid = 0, i = 0;
+    for (; i + 64 <= count; i += 64) {
+        uint64_t word;
+        memcpy(&word, validity + (i >> 3), sizeof(word));
+        valid += __builtin_popcountll(word);
+    }
+    for (; i < count; i++) {
+        valid += is_valid(validity, i);
+    }
+    return count - valid;
+}
+
+/**
+ * Copies the valid slots of a[0, count) to valid[0, count - nulls) and returns the scan_keys of
+ * them. Every slot is written and the output advances by its validity bit instead of branching on
+ * it, which a null density around 50% would mispredict. valid must have room for count elements.
+ * The descents and the ascents aren't counted.
+ */
+template <class T>
+key_scan<T> compact_valid_keys(const T* a, size_t count, const uint8_t* validity, T* valid)
+{
+    key_scan<T> scan;
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++) {
+        const auto key = radix_key(a[i]);
+        const bool bit = is_valid(validity, i);
+        valid[n] = a[i];
+        if (bit) { // a conditional move
+            scan.orAll |= key;
+            scan.andAll &= key;
+        }
+        n += bit;
+    }
+    return scan;
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <algorithm>
+#include <stddef.h>
+#include <vector>
+
+#include "radix_key.h"
+
+/**
+ * Fast paths of the hybrid sort for the inputs which arrive (nearly) sorted, such as time series.
+ *
+ * scan_keys is the first pass of the sort: besides the varying bits of the keys it counts the
+ * descents and ascents between neighbours, which is enough to recognize sorted and descending
+ * input and to estimate how many runs there are. A few runs are merged, a few elements out of
+ * place are pulled out, sorted on their own and merged back, everything else goes to the radix sort.
+ */
+template <class T>
+struct key_scan {
+    using K = radix_key_t<T>;
+    K orAll = 0;
+    K andAll = ~(K)0;
+    size_t descents = 0; // i with a[i] < a[i - 1], in the order of radix_less
+    size_t ascents = 0; // i with a[i - 1] < a[i]
+
+    // see varying_bits
+    K varying() const { return orAll ^ andAll; }
+
+    void add(const key_scan& other)
+    {
+        orAll |= other.orAll;
+        andAll &= other.andAll;
+        descents += other.descents;
+        ascents += other.ascents;
+    }
+};
+
+// Scans a[lo, hi), the pair (a[lo - 1], a[lo]) included, so that the scans of consecutive chunks add up.
+template <class T>
+key_scan<T> scan_keys(const T* a, size_t lo, size_t hi)
+{
+    key_scan<T> scan;
+    if (lo == 0 && hi != 0) {
+        scan.orAll = scan.andAll = radix_key(a[0]);
+        lo = 1;
+    }
+    // a single pass which the compiler vectorizes, the comparisons are free next to the loads
+    for (size_t i = lo; i < hi; i++) {
+        const auto prev = radix_key(a[i - 1]), key = radix_key(a[i]);
+        scan.orAll |= key;
+        scan.andAll &= key;
+        scan.descents += key < prev;
+        scan.ascents += prev < key;
+    }
+    return scan;
+}
+
+namespace presorted {
+// merging r runs takes log2(r) passes, radix sorting 64-bit keys 4 to 8
+const size_t MAX_MERGE_RUNS = 8;
+// the outliers are looked for when there is at most one descent per OUTLIER_RATIO keys...
+const size_t OUTLIER_RATIO = 64;
+// ...and given up on once they exceed 1 / MAX_OUTLIER_RATIO of the keys
+const size_t MAX_OUTLIER_RATIO = 16;
+
+// Sorts data made of numRuns ascending runs by merging them pairwise, std::merge keeps it stable.
+// buf is the scratch area of count elements.
+template <class T>
+void merge_runs(T* data, size_t count, size_t numRuns, T* buf)
+{
+    std::vector<size_t> bounds { 0 };
+    bounds.reserve(numRuns + 1);
+    for (size_t i = 1; i < count; i++) {
+        if (radix_less()(data[i], data[i - 1])) {
+            bounds.push_back(i);
+        }
+    }
+    bounds.push_back(count);
+
+    T *from = data, *to = buf;
+    std::vector<size_t> merged;
+    while (bounds.size() > 2) {
+        merged.clear();
+        for (size_t i = 0; i + 1 < bounds.size(); i += 2) {
+            merged.push_back(bounds[i]);
+            if (i + 2 < bounds.size()) {
+                std::merge(from + bounds[i], from + bounds[i + 1], from + bounds[i + 1], from + bounds[i + 2], to + bounds[i], radix_less());
+            } else {
+                std::copy(from + bounds[i], from + bounds[i + 1], to + bounds[i]);
+            }
+        }
+        merged.push_back(count);
+        std::swap(from, to);
+        bounds.swap(merged);
+    }
+    if (from != data) {
+        std::copy(from, from + count, data);
+    }
+}
+
+/**
+ * Sorts the data which is sorted but for a few elements out of place.
+ *
+ * Every key smaller than the last one kept is moved to `side` together with that last one, which
+ * leaves the kept keys sorted and moves at most twice the minimal number of keys. `side` is
+ * sorted by sortSide(side, sideCount) and merged back from the end. Not stable, returns false
+ * with `data` permuted when there are too many outliers.
+ */
+template <class T, class SortFn>
+bool sort_outliers(T* data, size_t count, SortFn sortSide)
+{
+    const size_t maxSide = count / MAX_OUTLIER_RATIO;
+    std::vector<T> side;
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++) {
+        T value = data[i];
+        if (kept != 0 && radix_less()(value, data[kept - 1])) {
+            side.push_back(data[--kept]);
+            side.push_back(value);
+            if (side.size() > maxSide) {
+                // the holes data[kept, i] are exactly side.size() slots
+                std::copy(side.begin(), side.end(), data + kept);
+                return false;
+            }
+        } else {
+            data[kept++] = value;
+        }
+    }
+
+    sortSide(side.data(), side.size());
+    size_t out = count, j = side.size();
+    while (j != 0) {
+        data[--out] = (kept != 0 && radix_less()(side[j - 1], data[kept - 1])) ? data[--kept] : side[--j];
+    }
+    return true;
+}
+
+// The stable order of the indices of the descending keys: reversed, but the equal keys keep their order.
+template <class T, class I>
+void descending_indices(const T* keys, I* idx, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        idx[i] = (I)(count - 1 - i);
+    }
+    for (size_t lo = 0; lo < count;) {
+        size_t hi = lo + 1;
+        while (hi < count && radix_key(keys[idx[hi]]) == radix_key(keys[idx[lo]])) {
+            hi++;
+        }
+        std::reverse(idx + lo, idx + hi);
+        lo = hi;
+    }
+}
+}
+
+// Whether sort_presorted would try the scanned keys at all.
+template <class T>
+bool is_presorted(const key_scan<T>& scan, size_t count)
+{
+    using namespace presorted;
+    return scan.ascents == 0 || scan.descents < MAX_MERGE_RUNS || scan.descents * OUTLIER_RATIO <= count;
+}
+
+/**
+ * Sorts data[0, count) if the scan shows it is close to sorted, returns false if it should be
+ * radix sorted. `data` may be permuted in the latter case. The merge of the runs takes its buffer
+ * of count elements from scratch(), so that the callers can allocate it only when it is needed,
+ * sortSide(side, sideCount) sorts the outliers.
+ */
+template <class T, class ScratchFn, class SortFn>
+bool sort_presorted(T* data, size_t count, const key_scan<T>& scan, ScratchFn scratch, SortFn sortSide)
+{
+    using namespace presorted;
+    if (!is_presorted(scan, count)) {
+        return false;
+    }
+    if (scan.descents == 0) {
+        return true;
+    }
+    if (scan.ascents == 0) {
+        // the equal keys of a descending run are indistinguishable, so reversing is stable
+        std::reverse(data, data + count);
+        return true;
+    }
+    if (scan.descents < MAX_MERGE_RUNS) {
+        merge_runs(data, count, scan.descents + 1, scratch());
+        return true;
+    }
+    return sort_outliers(data, count, sortSide);
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+#include <x86intrin.h>
+
+/**
+ * How the radix sorts scatter the elements into the buckets.
+ *
+ * direct writes every element straight to its bucket. Past a few million elements the 256
+ * write streams don't fit into L1 and the TLB, so the scatter becomes miss bound.
+ * buffered stages the elements in a cache line sized buffer per bucket (software write
+ * combining) and writes the buckets one full line at a time, buffered_nt additionally writes
+ * the full lines with non-temporal stores which bypass the caches: it pays off only once the
+ * output doesn't fit into the LLC anyway.
+ */
+enum class scatter_mode {
+    direct,
+    buffered,
+    buffered_nt
+};
+
+#ifndef HEDLEY_NEVER_INLINE
+#define HEDLEY_NEVER_INLINE __attribute__((__noinline__))
+#endif
+
+namespace scatter_impl {
+const size_t CACHE_LINE = 64;
+
+template <class T>
+inline void stream_line(T* dst, const T* src)
+{
+    static_assert(CACHE_LINE % sizeof(__m128i) == 0, "");
+    for (size_t i = 0; i < CACHE_LINE / sizeof(__m128i); ++i) {
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst) + i, _mm_load_si128(reinterpret_cast<const __m128i*>(src) + i));
+    }
+}
+
+/**
+ * Software write combining scatter of from[0, count) into the queues.
+ *
+ * The slot j of a bucket's line buffer corresponds to the element j of the destination cache
+ * line, so the buffer of a bucket whose queue doesn't start at a line boundary begins at the
+ * offset of the queue within its line and every flush but the first and the last writes a whole
+ * aligned line.
+ */
+template <bool NON_TEMPORAL, size_t RADIX_SIZE, class T, class DigitFn>
+HEDLEY_NEVER_INLINE void scatter_buffered(const T* from, size_t count, T** queue_ptrs, DigitFn digit)
+{
+    static_assert(std::is_trivially_copyable<T>::value && CACHE_LINE % sizeof(T) == 0, "T must pack into cache lines");
+    constexpr size_t LINE = CACHE_LINE / sizeof(T);
+
+    alignas(CACHE_LINE) T lines[RADIX_SIZE][LINE];
+    T* line_ptrs[RADIX_SIZE]; // the destination line of every bucket
+    uint8_t fill[RADIX_SIZE], first[RADIX_SIZE];
+    for (size_t i = 0; i < RADIX_SIZE; ++i) {
+        size_t offset = (reinterpret_cast<uintptr_t>(queue_ptrs[i]) % CACHE_LINE) / sizeof(T);
+        line_ptrs[i] = queue_ptrs[i] - offset;
+        fill[i] = first[i] = offset;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        T value = from[i];
+        size_t index = digit(value);
+        lines[index][fill[index]++] = value;
+        if (fill[index] == LINE) {
+            if (NON_TEMPORAL && first[index] == 0) {
+                stream_line(line_ptrs[index], lines[index]);
+            } else {
+                memcpy(line_ptrs[index] + first[index], lines[index] + first[index], (LINE - first[index]) * sizeof(T));
+            }
+            line_ptrs[index] += LINE;
+            fill[index] = first[index] = 0;
+        }
+    }
+
+    for (size_t i = 0; i < RADIX_SIZE; ++i) {
+        memcpy(line_ptrs[i] + first[i], lines[i] + first[i], (fill[i] - first[i]) * sizeof(T));
+        queue_ptrs[i] = line_ptrs[i] + fill[i];
+    }
+    if (NON_TEMPORAL) {
+        _mm_sfence();
+    }
+}
+}
+
+// Scatters from[0, count) into the queues by digit(value), advancing queue_ptrs.
+template <scatter_mode MODE, size_t RADIX_SIZE, class T, class DigitFn>
+inline void radix_scatter(const T* from, size_t count, T** queue_ptrs, DigitFn digit)
+{
+    // the line buffers of more than 2048 buckets would take over 128K of the stack and miss L2 anyway
+    if constexpr (MODE == scatter_mode::direct || RADIX_SIZE > 2048) {
+        for (size_t i = 0; i < count; i++) {
+            T value = from[i];
+            *queue_ptrs[digit(value)]++ = value;
+        }
+    } else {
+        scatter_impl::scatter_buffered<MODE == scatter_mode::buffered_nt, RADIX_SIZE>(from, count, queue_ptrs, digit);
+    }
+}
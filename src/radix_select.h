@@ -0,0 +1,254 @@
+#pragma once
+
+#include <algorithm>
+#include <assert.h>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "radix_digits.h"
+#include "radix_histogram.h"
+#include "radix_sort_hybrid.h"
+
+/**
+ * Radix selection, for ORDER BY ... LIMIT k and the percentiles. The element of rank k is found
+ * by the MSD levels of the radix sorts which only descend into the bucket holding the rank: the
+ * top level histogram reads the input and that bucket is gathered into a buffer, the levels below
+ * histogram and compact the buffer in place. The buckets shrink by RADIX_SIZE per level on
+ * uniform keys, so the selection costs about two passes over the input.
+ *
+ * The in-place primitives, std::nth_element and std::partial_sort, then partition the input
+ * around the selected element. Permuting all the buckets of every level as radix_sort_inplace
+ * does was tried instead and lost to std::nth_element: the cycles of the top level alone cost as
+ * much as introselect. The partitions below don't branch on the keys unless the ranks are skewed.
+ */
+namespace select_impl {
+// below this size std::nth_element and std::sort beat a histogram over RADIX_SIZE buckets
+const size_t SMALL_SELECT_THRESHOLD = 256;
+
+// The element of rank k of buf[0, n), which is clobbered, pass is the digit to look at.
+template <size_t RADIX_BITS, class T>
+T select_in_buffer(T* buf, size_t n, size_t k, size_t pass)
+{
+    constexpr size_t RADIX_SIZE = radix_digits<RADIX_BITS>::RADIX_SIZE;
+    for (;; --pass) {
+        if (n < SMALL_SELECT_THRESHOLD) {
+            std::nth_element(buf, buf + k, buf + n, radix_less());
+            return buf[k];
+        }
+        const size_t shift = pass * RADIX_BITS;
+        size_t freq[RADIX_SIZE];
+        count_digit<RADIX_BITS>(buf, n, shift, freq);
+
+        size_t bucket = 0;
+        while (freq[bucket] <= k) {
+            k -= freq[bucket++];
+        }
+        if (freq[bucket] != n) {
+            // the bucket of rank k moves to the front, the writes never pass the reads
+            size_t out = 0;
+            for (size_t i = 0; i < n; ++i) {
+                if (radix_digit<RADIX_BITS>(buf[i], shift) == bucket)
+                    buf[out++] = buf[i];
+            }
+            n = out;
+        }
+        if (pass == 0) {
+            return buf[k]; // all the keys left are equal
+        }
+    }
+}
+
+// Moves the elements satisfying pred to the front of a[0, count), returns their number. Every
+// element is swapped with the first one not satisfying pred, whether it satisfies it or not, so
+// the loop has no branch to mispredict (branch free Lomuto partition).
+template <class T, class Pred>
+size_t partition_branch_free(T* a, size_t count, Pred pred)
+{
+    size_t j = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const T value = a[i];
+        const bool satisfies = pred(value);
+        a[i] = a[j];
+        a[j] = value;
+        j += satisfies;
+    }
+    return j;
+}
+
+// Partitions a[0, count) into the keys less than `key`, the equal ones and the greater ones,
+// returns the ends of the first two parts. Balanced parts take the branch free partition twice,
+// skewed ones, with few keys less or greater, a single pass whose branches predict well.
+template <class T, class K>
+std::pair<size_t, size_t> partition3(T* a, size_t count, K key, bool skewed)
+{
+    if (!skewed) {
+        const size_t l = partition_branch_free(a, count, [key](T v) { return radix_key(v) < key; });
+        return { l, l + partition_branch_free(a + l, count - l, [key](T v) { return radix_key(v) == key; }) };
+    }
+    size_t l = 0, e = 0; // [0, l) less, [l, e) equal, [e, i) greater
+    for (size_t i = 0; i < count; ++i) {
+        const K k = radix_key(a[i]);
+        if (k < key) {
+            const T value = a[i];
+            a[i] = a[e];
+            a[e++] = a[l];
+            a[l++] = value;
+        } else if (k == key) {
+            std::swap(a[i], a[e++]);
+        }
+    }
+    return { l, e };
+}
+}
+
+// The element of rank k of data[0, count) without modifying it, see select_impl.
+template <size_t RADIX_BITS = 8, class T>
+T radix_select(const T* data, size_t count, size_t k)
+{
+    constexpr size_t RADIX_SIZE = radix_digits<RADIX_BITS>::RADIX_SIZE;
+    details::check_digit_width<RADIX_BITS>();
+    assert(k < count);
+    const auto varying = varying_bits(data, count);
+    if (varying == 0) {
+        return data[0];
+    }
+    const size_t pass = radix_digits<RADIX_BITS>::top_level(varying);
+    const size_t shift = pass * RADIX_BITS;
+    size_t freq[RADIX_SIZE];
+    count_digit<RADIX_BITS>(data, count, shift, freq);
+
+    size_t bucket = 0;
+    while (freq[bucket] <= k) {
+        k -= freq[bucket++];
+    }
+    std::unique_ptr<T[]> buf(new T[freq[bucket]]);
+    size_t n = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (radix_digit<RADIX_BITS>(data[i], shift) == bucket)
+            buf[n++] = data[i];
+    }
+    if (pass == 0) {
+        return buf[k];
+    }
+    return select_impl::select_in_buffer<RADIX_BITS>(buf.get(), n, k, pass - 1);
+}
+
+namespace select_impl {
+// Moves the elements of the sorted ranks [ranks, ranksEnd) of a[lo, hi) to their sorted
+// positions, with the elements before a rank not greater than it and the ones after not less,
+// as std::nth_element leaves them. The ranks index `a`.
+template <size_t RADIX_BITS, class T>
+void select_ranks(T* a, size_t lo, size_t hi, const size_t* ranks, const size_t* ranksEnd)
+{
+    if (ranks == ranksEnd) {
+        return;
+    }
+    if (hi - lo < SMALL_SELECT_THRESHOLD) {
+        if (ranksEnd - ranks == 1)
+            std::nth_element(a + lo, a + *ranks, a + hi, radix_less());
+        else
+            std::sort(a + lo, a + hi, radix_less());
+        return;
+    }
+
+    // the middle rank splits the range, the ranks on either side go on in their part
+    const size_t* middle = ranks + (ranksEnd - ranks) / 2;
+    const size_t rank = *middle - lo, count = hi - lo;
+    const auto key = radix_key(radix_select<RADIX_BITS>(a + lo, count, rank));
+    const bool skewed = rank < count / 8 || rank > count - count / 8;
+    const auto ends = partition3(a + lo, count, key, skewed);
+    const size_t lessEnd = lo + ends.first, equalEnd = lo + ends.second;
+
+    select_ranks<RADIX_BITS>(a, lo, lessEnd, ranks, std::lower_bound(ranks, ranksEnd, lessEnd));
+    select_ranks<RADIX_BITS>(a, equalEnd, hi, std::lower_bound(ranks, ranksEnd, equalEnd), ranksEnd);
+}
+}
+
+// std::nth_element: data[k] becomes the element of rank k, the smaller ones are before it.
+template <size_t RADIX_BITS = 8, class T>
+void radix_nth_element(T* data, size_t count, size_t k)
+{
+    assert(k < count);
+    select_impl::select_ranks<RADIX_BITS>(data, 0, count, &k, &k + 1);
+}
+
+// std::partial_sort: data[0, k) becomes the k smallest elements in order, the rest is left unordered.
+template <size_t RADIX_BITS = 8, class T>
+void radix_partial_sort(T* data, size_t count, size_t k)
+{
+    assert(k <= count);
+    if (k == 0) {
+        return;
+    }
+    radix_nth_element<RADIX_BITS>(data, count, k - 1);
+    radix_sort_hybrid<RADIX_BITS>(data, k - 1);
+}
+
+/**
+ * Batched quantiles: out[i] = the element of rank quantiles[i] * (count - 1), rounded down, of
+ * data[0, count), which is permuted. The middle rank partitions the data and the ranks on
+ * either side of it go on in their part, so the later selections read less and less of it.
+ */
+template <size_t RADIX_BITS = 8, class T>
+void radix_quantiles(T* data, size_t count, const double* quantiles, size_t numQuantiles, T* out)
+{
+    if (count == 0) {
+        return;
+    }
+    std::vector<size_t> ranks(numQuantiles);
+    for (size_t i = 0; i < numQuantiles; ++i) {
+        assert(quantiles[i] >= 0 && quantiles[i] <= 1);
+        ranks[i] = std::min(count - 1, (size_t)(quantiles[i] * (count - 1)));
+    }
+    std::vector<size_t> sortedRanks(ranks);
+    std::sort(sortedRanks.begin(), sortedRanks.end());
+    sortedRanks.erase(std::unique(sortedRanks.begin(), sortedRanks.end()), sortedRanks.end());
+    select_impl::select_ranks<RADIX_BITS>(data, 0, count, sortedRanks.data(), sortedRanks.data() + sortedRanks.size());
+    for (size_t i = 0; i < numQuantiles; ++i) {
+        out[i] = data[ranks[i]];
+    }
+}
+
+/**
+ * Stable top-k: the indices of the k smallest elements of data[0, count) in sorted order, the
+ * equal ones in the order of their indices, which is what ORDER BY ... LIMIT k returns. data is
+ * left untouched: the k-th element is selected on a copy of its bucket, one pass takes the
+ * indices of the smaller elements and of the first equal ones, and only those k are argsorted.
+ */
+template <size_t RADIX_BITS = 8, class T, class I>
+void radix_top_k_indices(const T* data, size_t count, size_t k, I* indices)
+{
+    static_assert(std::is_unsigned<I>::value && (sizeof(I) == 4 || sizeof(I) == 8), "I must be uint32_t or uint64_t");
+    assert(k <= count && count <= (size_t)std::numeric_limits<I>::max());
+    if (k == 0) {
+        return;
+    }
+    const auto threshold = radix_key(radix_select<RADIX_BITS>(data, count, k - 1));
+
+    // the smaller ones go to the front in order, the equal ones to the back until k are taken
+    size_t less = 0, equal = 0;
+    std::unique_ptr<I[]> equalIdx(new I[k]);
+    for (size_t i = 0; i < count; ++i) {
+        const auto key = radix_key(data[i]);
+        if (key < threshold)
+            indices[less++] = (I)i;
+        else if (key == threshold && equal < k)
+            equalIdx[equal++] = (I)i;
+    }
+    std::copy(equalIdx.get(), equalIdx.get() + (k - less), indices + less);
+
+    // the equal keys already follow the smaller ones, only the smaller ones need sorting
+    std::vector<T> keys(less);
+    for (size_t i = 0; i < less; ++i) {
+        keys[i] = data[indices[i]];
+    }
+    std::vector<I> order;
+    radix_argsort_hybrid<RADIX_BITS>(keys, order);
+    for (size_t i = 0; i < less; ++i) {
+        equalIdx[i] = indices[order[i]];
+    }
+    std::copy(equalIdx.get(), equalIdx.get() + less, indices);
+}
@@ -0,0 +1,336 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "radix_sort_hybrid.h"
+#include "radix_sort_lsd.h"
+#include "radix_sort_msd.h"
+
+/**
+ * The front door: radix_sort samples the input and sorts it by whichever of the sorts a cost
+ * model expects to be the fastest, none of them wins everywhere. LSD pays a scatter per digit of
+ * the widest key whatever the distribution, MSD stops early on dense keys but its histograms
+ * outweigh the buckets once they get sparse, the hybrid switches to LSD before that, the
+ * comparison sort wins on a handful of keys and the presorted inputs only need a merge.
+ *
+ * The sample is SAMPLE_BLOCKS runs of neighbouring keys at equal strides, a cache line each: their
+ * varying bits give the width of the keys, their duplicates the number of distinct keys, and the
+ * neighbours the sortedness. The model walks the levels of the MSD recursion on the expected
+ * bucket sizes and charges every pass per key, by the cache level its range fits in, and every
+ * bucket its histogram, see dispatch_impl. The plan is returned, with its estimates and costs, for
+ * logging.
+ */
+enum class sort_route {
+    comparison, // std::stable_sort
+    lsd, // radix_sort_lsd_travis
+    msd, // radix_sort_msd
+    hybrid, // radix_sort_hybrid
+    merge, // the presorted paths of radix_sort_hybrid, see radix_presorted.h
+};
+
+inline const char* sort_route_name(sort_route route)
+{
+    switch (route) {
+    case sort_route::comparison:
+        return "comparison";
+    case sort_route::lsd:
+        return "lsd";
+    case sort_route::msd:
+        return "msd";
+    case sort_route::hybrid:
+        return "hybrid";
+    case sort_route::merge:
+        return "merge";
+    }
+    return "?";
+}
+
+struct sort_plan {
+    sort_route route = sort_route::hybrid;
+    // the estimates from the sample
+    size_t sampled = 0;
+    size_t keyBits = 0; // up to the highest varying bit
+    double distinct = 0; // estimated distinct keys of the input, 0 for a presorted sample
+    double descentRatio = 0; // of the sampled neighbours
+    // the modeled costs of the routes in key passes, the ones not considered are infinite
+    double costs[5] = { INFINITY, INFINITY, INFINITY, INFINITY, INFINITY };
+    // why the route was taken, for the logs
+    std::string reason;
+
+    std::string describe() const
+    {
+        std::string text = std::string(sort_route_name(route)) + ": " + reason;
+        if (sampled != 0) {
+            text += " (sampled " + std::to_string(sampled) + ", " + std::to_string(keyBits) + " bits, ~"
+                + std::to_string((size_t)distinct) + " distinct, descents " + std::to_string(descentRatio) + "; costs";
+            for (size_t r = 0; r < 5; ++r) {
+                if (std::isfinite(costs[r]))
+                    text += std::string(" ") + sort_route_name((sort_route)r) + " " + std::to_string(costs[r]);
+            }
+            text += ")";
+        }
+        return text;
+    }
+};
+
+namespace dispatch_impl {
+// the sample: SAMPLE_BLOCKS runs of SAMPLE_BLOCK neighbours, a cache line of 64-bit keys each
+const size_t SAMPLE_BLOCKS = 256;
+const size_t SAMPLE_BLOCK = 8;
+const size_t SAMPLE_SIZE = SAMPLE_BLOCKS * SAMPLE_BLOCK;
+// below this size the hybrid sort is taken without sampling: the sample would cost more than a
+// wrong route
+const size_t MIN_SAMPLED_COUNT = 1 << 16;
+
+// The costs per key of the model, relative to a histogram pass over cached keys. The defaults
+// minimize the time lost to the wrong routes over the distributions of diffdistrib_bmk and uniform
+// keys of 16 to 64 bits, from 64K to 4M keys.
+struct cost_model {
+    double count = 1; // a histogram pass
+    double scan = 2; // scan_keys of the hybrid sort, the varying bits and the descents
+    double scatterL1 = 1; // a scatter pass of a range of at most L1_KEYS
+    double scatterCached = 1.5; // a scatter pass of a range which stays in L2
+    double scatterMemory = 2.25; // a scatter pass of a larger range
+    double scatterEven = 2; // on top of an LSD pass over the permutation of a range, see lsd_cost
+    double bucket = 2.5; // per histogram bucket: clearing, the prefix sum, is_trivial
+    double compare = 13; // per comparison of std::stable_sort, a branch miss every other one
+};
+
+// keys which stay in L1 with their scratch and the buckets
+const size_t L1_KEYS = 2048;
+
+inline double scatter_cost(const cost_model& m, double count)
+{
+    if (count <= L1_KEYS)
+        return m.scatterL1;
+    return count < radix_tuning_profile().lsdThreshold ? m.scatterCached : m.scatterMemory;
+}
+
+inline double compare_cost(const cost_model& m, double count) { return count < 2 ? 0 : count * std::log2(count) * m.compare; }
+
+// LSD passes over count keys of `bits` bits, histogramLevels digits counted in its first pass.
+// The keys without duplicates which fill their range, say a permutation, fill all the buckets of
+// every digit equally: the write positions of the passes move in lockstep through the same cache
+// sets and evict each other.
+template <size_t RADIX_BITS>
+double lsd_cost(const cost_model& m, double count, size_t bits, double distinct, size_t histogramLevels)
+{
+    constexpr size_t RADIX_SIZE = radix_digits<RADIX_BITS>::RADIX_SIZE;
+    const size_t passes = distinct <= 1 ? 0 : (bits + RADIX_BITS - 1) / RADIX_BITS;
+    const bool even = distinct >= count && 2 * count >= std::ldexp(1.0, (int)bits);
+    const double scatter = scatter_cost(m, count) + (even ? m.scatterEven : 0);
+    return count * m.count * histogramLevels / 2 + passes * (count * scatter + RADIX_SIZE * m.bucket);
+}
+
+// The MSD recursion over count keys whose top `bits` bits vary, `distinct` of them uniform: the
+// top digit splits them into buckets, which recurse on the digits below. The hybrid sort hands the
+// ranges below the LSD threshold over to the LSD passes, radix_sort_msd has no small sort
+// (smallSort 2) and pays a histogram per level for the buckets of a few keys.
+template <size_t RADIX_BITS>
+double msd_cost(const cost_model& m, double count, size_t bits, double distinct, size_t smallSort, bool hybrid)
+{
+    constexpr size_t RADIX_SIZE = radix_digits<RADIX_BITS>::RADIX_SIZE;
+    if (count < 2 || bits == 0)
+        return 0;
+    if (count < smallSort)
+        return compare_cost(m, count);
+    if (hybrid && count < radix_tuning_profile().lsdThreshold)
+        return lsd_cost<RADIX_BITS>(m, count, bits, distinct, (bits + RADIX_BITS - 1) / RADIX_BITS);
+    const size_t below = (bits - 1) / RADIX_BITS * RADIX_BITS; // the bits of the digits below the top one
+    if (distinct <= 1) // a histogram per digit, all of them trivial
+        return (count * m.count + RADIX_SIZE * m.bucket) * ((bits + RADIX_BITS - 1) / RADIX_BITS);
+    // the distinct keys fall into `slots` buckets at random: the ones left alone are sorted, the
+    // others recurse, on average (count - alone) / multiple keys per bucket
+    const double slots = std::min(std::ldexp(1.0, (int)(bits - below)), distinct);
+    const double perSlot = count / slots;
+    const double alone = count * std::exp(-perSlot);
+    const double multiple = slots * (1 - std::exp(-perSlot) * (1 + perSlot));
+    double cost = count * (m.count + scatter_cost(m, count)) + RADIX_SIZE * m.bucket;
+    if (multiple >= 1) {
+        const double bucket = (count - alone) / multiple;
+        cost += multiple * msd_cost<RADIX_BITS>(m, bucket, below, std::max(1.0, distinct * bucket / count), smallSort, hybrid);
+    }
+    return cost;
+}
+
+// The distinct keys of the input from the sample, counted in an open addressed table: the sample
+// itself, plus the unseen ones estimated from the keys seen once and twice (Chao1), up to count
+// and to the values of the bits.
+template <class K>
+double estimate_distinct(const K* sample, size_t sampled, size_t count, size_t bits)
+{
+    const size_t TABLE_BITS = 12;
+    static_assert(SAMPLE_SIZE * 2 <= ((size_t)1 << TABLE_BITS), "the table is at most half full");
+    std::vector<std::pair<K, uint32_t>> table((size_t)1 << TABLE_BITS);
+    size_t distinct = 0;
+    for (size_t s = 0; s < sampled; ++s) {
+        uint64_t folded = (uint64_t)sample[s];
+        if constexpr (sizeof(K) > 8)
+            folded ^= (uint64_t)(sample[s] >> 64);
+        size_t slot = (size_t)((folded * 0x9E3779B97F4A7C15ull) >> (64 - TABLE_BITS));
+        while (table[slot].second != 0 && table[slot].first != sample[s])
+            slot = (slot + 1) & (table.size() - 1);
+        distinct += table[slot].second == 0;
+        table[slot].first = sample[s];
+        ++table[slot].second;
+    }
+    size_t once = 0, twice = 0;
+    for (const auto& entry : table) {
+        once += entry.second == 1;
+        twice += entry.second == 2;
+    }
+    if (once == sampled)
+        return count; // all distinct, the sample can't tell more
+    const double unseen = twice != 0 ? (double)once * once / (2.0 * twice) : (double)once * (once - 1) / 2.0;
+    // the keys with a twin in the sample are as common in the input at least, half of them duplicates
+    const double twinned = (double)(sampled - once) / sampled;
+    const double estimate = std::min(distinct + unseen, count * (1 - twinned / 2));
+    return std::min({ estimate, (double)count, std::ldexp(1.0, (int)std::min<size_t>(bits, 64)) });
+}
+}
+
+/**
+ * Samples data[0, count) and returns the route radix_sort takes, the estimates and the costs the
+ * model gives every route.
+ */
+template <size_t RADIX_BITS = 8, class T>
+sort_plan plan_radix_sort(const T* data, size_t count, const dispatch_impl::cost_model& model = {})
+{
+    using namespace dispatch_impl;
+    using K = radix_key_t<T>;
+    sort_plan plan;
+    if constexpr (is_counting_sortable<T>()) {
+        plan.reason = "8/16-bit keys are counting sorted";
+        return plan;
+    }
+    if (count < details::small_sort_threshold<RADIX_BITS>()) {
+        plan.route = sort_route::comparison;
+        plan.reason = "few keys for the radix passes";
+        return plan;
+    }
+    if (count < MIN_SAMPLED_COUNT) {
+        plan.reason = "too small to sample";
+        return plan;
+    }
+
+    // SAMPLE_BLOCKS runs of neighbours at equal strides
+    const size_t stride = count / SAMPLE_BLOCKS;
+    K sample[SAMPLE_SIZE];
+    K orAll = 0, andAll = ~(K)0;
+    size_t descents = 0, ascents = 0;
+    for (size_t b = 0; b < SAMPLE_BLOCKS; ++b) {
+        const T* block = data + b * stride;
+        K* sampleBlock = sample + b * SAMPLE_BLOCK;
+        for (size_t i = 0; i < SAMPLE_BLOCK; ++i) {
+            const K key = radix_key(block[i]);
+            sampleBlock[i] = key;
+            orAll |= key;
+            andAll &= key;
+        }
+        for (size_t i = 1; i < SAMPLE_BLOCK; ++i) {
+            descents += sampleBlock[i] < sampleBlock[i - 1];
+            ascents += sampleBlock[i - 1] < sampleBlock[i];
+        }
+    }
+    const size_t pairs = SAMPLE_BLOCKS * (SAMPLE_BLOCK - 1);
+    const K varying = orAll ^ andAll;
+    plan.sampled = SAMPLE_SIZE;
+    plan.keyBits = varying == 0 ? 0 : radix_digits<1>::top_level(varying) + 1;
+    plan.descentRatio = (double)descents / pairs;
+    // a sorted or reversed sample of varying keys takes the merge route, the radix sorts aren't
+    // modeled on it
+    const bool presortedSample = varying != 0 && (descents == 0 || ascents == 0);
+    if (varying == 0)
+        plan.distinct = 1;
+    else if (!presortedSample)
+        plan.distinct = estimate_distinct(sample, SAMPLE_SIZE, count, plan.keyBits);
+
+    const double n = count;
+    auto& costs = plan.costs;
+    if (!presortedSample) {
+        const size_t smallSort = details::small_sort_threshold<RADIX_BITS>();
+        costs[(int)sort_route::comparison] = compare_cost(model, n);
+        costs[(int)sort_route::lsd] = lsd_cost<RADIX_BITS>(model, n, plan.keyBits, plan.distinct, radix_digits<RADIX_BITS>::template levels<T>());
+        costs[(int)sort_route::msd] = n * model.count + msd_cost<RADIX_BITS>(model, n, plan.keyBits, plan.distinct, 2, false);
+        costs[(int)sort_route::hybrid] = n * model.scan + msd_cost<RADIX_BITS>(model, n, plan.keyBits, plan.distinct, smallSort, true);
+    }
+    // the presorted paths which the sample expects: nothing, a reversal or the outliers pulled out
+    // and merged back, see sort_presorted
+    if (descents == 0) {
+        costs[(int)sort_route::merge] = n * model.scan;
+    } else if (ascents == 0) {
+        costs[(int)sort_route::merge] = n * (model.scan + model.scatterCached);
+    } else if (descents * presorted::OUTLIER_RATIO <= pairs) {
+        costs[(int)sort_route::merge] = n * (model.scan + 2 * model.scatterCached);
+    }
+
+    size_t best = 0;
+    for (size_t r = 1; r < 5; ++r) {
+        if (costs[r] < costs[best])
+            best = r;
+    }
+    plan.route = (sort_route)best;
+    switch (plan.route) {
+    case sort_route::comparison:
+        plan.reason = "few keys for the radix passes";
+        break;
+    case sort_route::lsd:
+        plan.reason = "narrow keys, a scatter per digit is the least";
+        break;
+    case sort_route::msd:
+        plan.reason = plan.distinct <= 1 ? "all the keys equal" : "dense keys, the MSD buckets stay full";
+        break;
+    case sort_route::hybrid:
+        plan.reason = "sparse keys, the LSD passes take the small buckets";
+        break;
+    case sort_route::merge:
+        plan.reason = descents == 0 ? "sorted sample" : ascents == 0 ? "descending sample" : "few sampled descents";
+        break;
+    }
+    return plan;
+}
+
+// Sorts data[0, count) by the route of plan_radix_sort, see above, and returns the plan.
+// scratch is radix_sort_scratch_size(count) elements.
+template <size_t RADIX_BITS = 8, class T>
+sort_plan radix_sort(T* data, size_t count, T* scratch)
+{
+    const sort_plan plan = plan_radix_sort<RADIX_BITS>(data, count);
+    switch (plan.route) {
+    case sort_route::comparison:
+        std::stable_sort(data, data + count, radix_less());
+        break;
+    case sort_route::lsd:
+        radix_sort_lsd_travis<RADIX_BITS>(data, count, scratch);
+        break;
+    case sort_route::msd:
+        radix_sort_msd<RADIX_BITS>(data, count, scratch);
+        break;
+    case sort_route::hybrid:
+    case sort_route::merge:
+        // the hybrid sort checks the whole input for the presorted paths, the sample may be wrong
+        radix_sort_hybrid<RADIX_BITS>(data, count, scratch);
+        break;
+    }
+    return plan;
+}
+
+template <size_t RADIX_BITS = 8, class T>
+sort_plan radix_sort(T* data, size_t count)
+{
+    std::unique_ptr<T[]> scratch(new T[radix_sort_scratch_size<T>(count)]);
+    return radix_sort<RADIX_BITS>(data, count, scratch.get());
+}
+
+template <size_t RADIX_BITS = 8, class T>
+sort_plan radix_sort(std::vector<T>& data)
+{
+    return radix_sort<RADIX_BITS>(data.data(), data.size());
+}
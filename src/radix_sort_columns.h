@@ -0,0 +1,129 @@
+#pragma once
+
+#include <assert.h>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "radix_sort_hybrid.h"
+
+// A key column of ORDER BY: count values, the row i is data[i]. The columns of an ORDER BY have
+// their own key types, the descriptor keeps the type only in its gather functions: the keys of
+// all the types up to 64 bits are gathered as uint64_t, zero extended, which keeps their order.
+class sort_column {
+public:
+    template <class T>
+    sort_column(const T* data, bool descending = false)
+        : m_data(data)
+        , m_descending(descending)
+        , m_gather32(&gather_keys<T, uint32_t>)
+        , m_gather64(&gather_keys<T, uint64_t>)
+    {
+        static_assert(sizeof(radix_key_t<T>) <= sizeof(uint64_t), "the 128-bit keys don't fit into the gathered keys");
+    }
+
+    bool descending() const { return m_descending; }
+
+    // Gathers the keys of the rows idx[lo, hi) into keys[lo, hi), in the order of the column: the
+    // descending columns invert them. Returns the bits which vary between them.
+    template <class I>
+    uint64_t gather(const I* idx, uint64_t* keys, size_t lo, size_t hi) const
+    {
+        if constexpr (sizeof(I) == sizeof(uint32_t))
+            return m_gather32(m_data, m_descending, idx, keys, lo, hi);
+        else
+            return m_gather64(m_data, m_descending, idx, keys, lo, hi);
+    }
+
+private:
+    template <class I>
+    using gather_fn = uint64_t (*)(const void*, bool, const I*, uint64_t*, size_t, size_t);
+
+    template <class T, class I>
+    static uint64_t gather_keys(const void* data, bool descending, const I* idx, uint64_t* keys, size_t lo, size_t hi)
+    {
+        using K = radix_key_t<T>;
+        const T* values = static_cast<const T*>(data);
+        const K flip = descending ? ~(K)0 : 0;
+        uint64_t orAll = 0, andAll = ~(uint64_t)0;
+        for (size_t i = lo; i < hi; ++i) {
+            const uint64_t key = (K)(radix_key(values[idx[i]]) ^ flip);
+            keys[i] = key;
+            orAll |= key;
+            andAll &= key;
+        }
+        return orAll ^ andAll;
+    }
+
+    const void* m_data;
+    bool m_descending;
+    gather_fn<uint32_t> m_gather32;
+    gather_fn<uint64_t> m_gather64;
+};
+
+namespace columns_impl {
+// Gathers the keys of the rows idx[lo, hi) of the first column into keys[lo, hi), sorts the
+// range and breaks the ties, the ranges of equal keys, by the next columns. Depth first, so a
+// range is refined while it is still in the caches.
+template <size_t RADIX_BITS, class I>
+void sort_columns_rec(const sort_column* columns, size_t numColumns, uint64_t* keys, I* idx, argsort_scratch<uint64_t, I>& scratch,
+    size_t lo, size_t hi)
+{
+    const uint64_t varying = columns[0].gather(idx, keys, lo, hi);
+    if (varying == 0) {
+        // the column doesn't break any tie
+        if (numColumns > 1)
+            sort_columns_rec<RADIX_BITS>(columns + 1, numColumns - 1, keys, idx, scratch, lo, hi);
+        return;
+    }
+    details::radix_msd_rec_indices<RADIX_BITS>(keys, idx, scratch.keysBuf.data(), scratch.indicesBuf.data(), lo, hi,
+        radix_digits<RADIX_BITS>::top_level(varying), false);
+    if (numColumns == 1)
+        return;
+
+    for (size_t runLo = lo; runLo < hi;) {
+        size_t runHi = runLo + 1;
+        while (runHi < hi && keys[runHi] == keys[runLo]) {
+            ++runHi;
+        }
+        if (runHi - runLo > 1) {
+            sort_columns_rec<RADIX_BITS>(columns + 1, numColumns - 1, keys, idx, scratch, runLo, runHi);
+        }
+        runLo = runHi;
+    }
+}
+}
+
+/**
+ * Stable argsort of the rows [0, count) of a table by several key columns, ORDER BY columns[0],
+ * columns[1], ...: the rows equal in all the columns keep their original order.
+ *
+ * Chaining stable argsorts from the last column to the first radix sorts all the rows once per
+ * column. Here the first column is MSD sorted with the indices as payload, then only the ranges of
+ * its equal keys are gathered from the next column and sorted, and so on, so a column costs in
+ * proportion to the ties left by the ones before it: nothing after a unique column. The ranges
+ * go down to the LSD tails and the insertion sort of radix_msd_rec_indices by their size. The
+ * columns may have different key types, an int32_t column after an int64_t one.
+ */
+template <size_t RADIX_BITS = 8, class I>
+void radix_argsort_columns(const sort_column* columns, size_t numColumns, size_t count, I* indices, argsort_scratch<uint64_t, I>& scratch)
+{
+    details::check_digit_width<RADIX_BITS>();
+    static_assert(std::is_unsigned<I>::value && (sizeof(I) == 4 || sizeof(I) == 8), "I must be uint32_t or uint64_t");
+    assert(count <= (size_t)std::numeric_limits<I>::max());
+
+    for (size_t i = 0; i < count; ++i)
+        indices[i] = (I)i;
+    scratch.reserve(count);
+
+    if (count > 1 && numColumns != 0)
+        columns_impl::sort_columns_rec<RADIX_BITS>(columns, numColumns, scratch.keys.data(), indices, scratch, 0, count);
+}
+
+template <size_t RADIX_BITS = 8, class I = uint32_t>
+void radix_argsort_columns(const std::vector<sort_column>& columns, size_t count, std::vector<I>& indices)
+{
+    argsort_scratch<uint64_t, I> scratch;
+    indices.resize(count);
+    radix_argsort_columns<RADIX_BITS>(columns.data(), columns.size(), count, indices.data(), scratch);
+}
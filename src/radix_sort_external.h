@@ -0,0 +1,248 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <errno.h>
+#include <fcntl.h>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+
+#include "radix_digits.h"
+#include "radix_sort_hybrid.h"
+
+/**
+ * External (out-of-core) sort of a file of raw keys, count * sizeof(T) bytes in the native byte
+ * order, into another file, for the inputs larger than the memory.
+ *
+ * The input is memory-mapped and MSD partitioned by its top varying digit into RADIX_SIZE bucket
+ * files by buffered sequential writes. A bucket which fits the memory budget is then sorted by
+ * radix_sort_hybrid_copy straight from its mapping and appended to the output, a larger one is
+ * partitioned again by its next digit. The buckets are key ranges in order, so the sorted ones
+ * are just concatenated: there is no merge phase and every key is written once per level.
+ *
+ * The budget is a single allocation, the buffer and the scratch of the in-memory sorts, which the
+ * partitions use as their bucket buffers in between. The bucket files go to tmpDir and are removed
+ * as soon as they are mapped, but a mapped bucket keeps its blocks until it is sorted. After the
+ * first partition tmpDir holds a whole copy of the input, and a bucket larger than the budget is
+ * partitioned again while it is mapped, which adds up to its size for every further level. The
+ * output takes the place of the level-0 buckets as they are sorted. So the peak disk usage is
+ * the input plus about the input again, plus the nested buckets: little on a uniform top digit,
+ * up to the input per level on a skewed one. The RADIX_SIZE bucket files of a level are open at
+ * once, so the 11-bit and wider digits need an RLIMIT_NOFILE above the default 1024.
+ *
+ * The I/O errors throw std::system_error, after the bucket files left on disk are removed. An
+ * input whose size isn't a multiple of sizeof(T) throws std::invalid_argument.
+ */
+struct external_sort_options {
+    size_t memoryBudget = (size_t)1 << 30; // bytes
+    std::string tmpDir = "/tmp";
+};
+
+namespace external_impl {
+[[noreturn]] inline void throw_errno(const std::string& what)
+{
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+// a read-only mapping of a whole file
+class mapped_file {
+public:
+    explicit mapped_file(const std::string& path)
+    {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw_errno("open " + path);
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw_errno("stat " + path);
+        }
+        m_size = st.st_size;
+        if (m_size != 0) {
+            m_data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (m_data == MAP_FAILED) {
+                ::close(fd);
+                throw_errno("mmap " + path);
+            }
+            // the pages are read once in order, the kernel reads ahead and drops them behind
+            ::madvise(m_data, m_size, MADV_SEQUENTIAL);
+        }
+        ::close(fd); // the mapping keeps the file
+    }
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+    ~mapped_file()
+    {
+        if (m_size != 0)
+            ::munmap(m_data, m_size);
+    }
+
+    template <class T>
+    const T* data() const { return static_cast<const T*>(m_data); }
+    size_t size() const { return m_size; }
+
+private:
+    void* m_data = nullptr;
+    size_t m_size = 0;
+};
+
+// sequential writes of whole buffers to a file created or truncated by the constructor
+class file_writer {
+public:
+    explicit file_writer(const std::string& path)
+        : m_path(path)
+        , m_fd(::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644))
+    {
+        if (m_fd < 0)
+            throw_errno("open " + path);
+    }
+    file_writer(const file_writer&) = delete;
+    file_writer& operator=(const file_writer&) = delete;
+    ~file_writer() { ::close(m_fd); }
+
+    void write(const void* data, size_t bytes)
+    {
+        const char* p = static_cast<const char*>(data);
+        while (bytes != 0) {
+            const ssize_t written = ::write(m_fd, p, bytes);
+            if (written < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw_errno("write " + m_path);
+            }
+            p += written;
+            bytes -= written;
+        }
+    }
+
+private:
+    std::string m_path;
+    int m_fd;
+};
+
+template <size_t RADIX_BITS, class T>
+class external_sorter {
+    static constexpr size_t RADIX_SIZE = radix_digits<RADIX_BITS>::RADIX_SIZE;
+
+public:
+    external_sorter(const external_sort_options& options, file_writer& out)
+        : m_tmpPrefix(options.tmpDir + "/radix_sort_external." + std::to_string(::getpid()) + "." + std::to_string((uintptr_t)this))
+        , m_memorySize(std::max(options.memoryBudget / sizeof(T), 2 * RADIX_SIZE))
+        , m_memory(new T[m_memorySize])
+        , m_out(out)
+    {
+    }
+
+    // sorts a[0, count) to the output, level names the bucket files of its partition
+    void sort(const T* a, size_t count, size_t level)
+    {
+        // the sorted keys and the scratch share the budget
+        const size_t capacity = m_memorySize / 2;
+        if (count <= capacity) {
+            radix_sort_hybrid_copy<RADIX_BITS>(a, count, m_memory.get(), m_memory.get() + capacity);
+            m_out.write(m_memory.get(), count * sizeof(T));
+            return;
+        }
+        const auto varying = varying_bits(a, count);
+        if (varying == 0) {
+            m_out.write(a, count * sizeof(T));
+            return;
+        }
+        const size_t shift = radix_digits<RADIX_BITS>::top_level(varying) * RADIX_BITS;
+        partition(a, count, shift, level);
+
+        // the top varying digit takes two values at least, every bucket is smaller than a
+        size_t next = 0; // the buckets [next, RADIX_SIZE) are still on disk
+        try {
+            for (size_t b = 0; b < RADIX_SIZE; ++b) {
+                if (m_bucketSizes[level][b] == 0)
+                    continue;
+                const std::string path = bucket_path(level, b);
+                mapped_file bucket(path);
+                ::unlink(path.c_str());
+                next = b + 1;
+                sort(bucket.data<T>(), bucket.size() / sizeof(T), level + 1);
+            }
+        } catch (...) {
+            for (; next < RADIX_SIZE; ++next) {
+                if (m_bucketSizes[level][next] != 0)
+                    ::unlink(bucket_path(level, next).c_str());
+            }
+            throw;
+        }
+    }
+
+private:
+    std::string bucket_path(size_t level, size_t bucket) const
+    {
+        return m_tmpPrefix + "." + std::to_string(level) + "." + std::to_string(bucket);
+    }
+
+    // scatters a[0, count) by the digit at shift to the bucket files of level, each bucket has
+    // a slice of the memory as its write buffer
+    void partition(const T* a, size_t count, size_t shift, size_t level)
+    {
+        if (m_bucketSizes.size() <= level)
+            m_bucketSizes.resize(level + 1);
+        auto& sizes = m_bucketSizes[level];
+        sizes.fill(0);
+
+        const size_t bufSize = m_memorySize / RADIX_SIZE;
+        size_t fill[RADIX_SIZE] = {};
+        std::unique_ptr<file_writer> files[RADIX_SIZE];
+        auto flush = [&](size_t b) {
+            if (!files[b])
+                files[b].reset(new file_writer(bucket_path(level, b)));
+            files[b]->write(m_memory.get() + b * bufSize, fill[b] * sizeof(T));
+            sizes[b] += fill[b];
+            fill[b] = 0;
+        };
+
+        try {
+            for (size_t i = 0; i < count; ++i) {
+                const size_t b = radix_digit<RADIX_BITS>(a[i], shift);
+                m_memory[b * bufSize + fill[b]] = a[i];
+                if (++fill[b] == bufSize)
+                    flush(b);
+            }
+            for (size_t b = 0; b < RADIX_SIZE; ++b) {
+                if (fill[b] != 0)
+                    flush(b);
+            }
+        } catch (...) {
+            // a full disk, most likely: none of the buckets of the level is complete
+            for (size_t b = 0; b < RADIX_SIZE; ++b) {
+                if (files[b])
+                    ::unlink(bucket_path(level, b).c_str());
+            }
+            throw;
+        }
+    }
+
+    const std::string m_tmpPrefix;
+    const size_t m_memorySize; // elements
+    std::unique_ptr<T[]> m_memory;
+    file_writer& m_out;
+    // the number of keys of the buckets of every level of the recursion
+    std::vector<std::array<size_t, RADIX_SIZE>> m_bucketSizes;
+};
+}
+
+template <size_t RADIX_BITS = 8, class T = uint64_t>
+void radix_sort_external(const std::string& inputPath, const std::string& outputPath,
+    const external_sort_options& options = external_sort_options())
+{
+    details::check_digit_width<RADIX_BITS>();
+    external_impl::mapped_file input(inputPath);
+    if (input.size() % sizeof(T) != 0)
+        throw std::invalid_argument(inputPath + ": " + std::to_string(input.size()) + " bytes aren't a whole number of keys");
+    external_impl::file_writer out(outputPath);
+    external_impl::external_sorter<RADIX_BITS, T> sorter(options, out);
+    sorter.sort(input.data<T>(), input.size() / sizeof(T), 0);
+}
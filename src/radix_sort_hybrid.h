@@ -1,17 +1,39 @@
+#pragma once
+
 #include <algorithm>
 #include <array>
 #include <assert.h>
+#include <limits>
 #include <memory>
 #include <string.h>
+#include <type_traits>
+#include <vector>
+
+#include "radix_counting_sort.h"
+#include "radix_digits.h"
+#include "radix_histogram.h"
+#include "radix_nulls.h"
+#include "radix_presorted.h"
+#include "radix_scatter.h"
+#include "radix_tuning.h"
+#include "radix_wide_keys.h"
+#include "work_stealing_pool.h"
 
 namespace details {
-const size_t RADIX_BITS = 8;
-const size_t RADIX_SIZE = 1ull << RADIX_BITS;
-const size_t RADIX_LEVELS = (63ull / RADIX_BITS) + 1ull;
-const size_t DO_FINAL_SWAP = RADIX_LEVELS & 1ull; // if RADIX_LEVELS is even, buf contains the result
-const size_t LSD_THRESHOLD = 1 << 14;
+// below this size a range takes the LSD passes, see radix_tuning.h
+inline size_t lsd_threshold() { return radix_tuning_profile().lsdThreshold; }
+// the buckets of a smaller range stay in L2, where the direct scatter is cheaper than the buffered one
+const size_t BUFFERED_SCATTER_THRESHOLD = 1 << 17;
 
-static bool is_trivial(size_t freqs[RADIX_SIZE], size_t count)
+// every level of the MSD recursion keeps its histogram and queue pointers on the stack
+template <size_t RADIX_BITS>
+constexpr void check_digit_width()
+{
+    static_assert(RADIX_BITS <= 12, "the MSD levels of the hybrid sort support at most 12-bit digits");
+}
+
+template <size_t RADIX_SIZE>
+static bool is_trivial(const size_t (&freqs)[RADIX_SIZE], size_t count)
 {
     for (size_t i = 0; i < RADIX_SIZE; i++) {
         auto freq = freqs[i];
@@ -22,29 +44,50 @@ static bool is_trivial(size_t freqs[RADIX_SIZE], size_t count)
     return true;
 }
 
-using freq_array_type = size_t[RADIX_LEVELS][RADIX_SIZE];
+// below this size a range is sorted by std::stable_sort: an LSD pass costs O(count + RADIX_SIZE)
+template <size_t RADIX_BITS>
+size_t small_sort_threshold() { return std::max<size_t>(radix_tuning_profile().smallSortThreshold, radix_digits<RADIX_BITS>::RADIX_SIZE / 16); }
 
-template <class T>
-static void count_frequency(T* a, size_t count, freq_array_type freqs, size_t hiPass)
+template <size_t RADIX_BITS, class T>
+static void count_frequency(T* a, size_t count, size_t (*freqs)[radix_digits<RADIX_BITS>::RADIX_SIZE], size_t hiPass)
 {
-    constexpr T RADIX_MASK = RADIX_SIZE - 1;
-    for (size_t i = 0; i < count; i++) {
-        T value = a[i];
-        for (size_t pass = 0; pass < hiPass; pass++) {
-            freqs[pass][value & RADIX_MASK]++;
-            value >>= RADIX_BITS;
+    count_digits<RADIX_BITS, radix_digits<RADIX_BITS>::template levels<T>()>(a, count, freqs, hiPass);
+}
+
+// The histograms of the digits [0, hiPass) of an LSD tail, zeroed. The tails run at every leaf of
+// the MSD recursion, so they stay on the stack unless the wide digits would take too much of it:
+// 96K for the 6 levels of 11-bit digits, the 12-bit digits go to the heap.
+template <size_t RADIX_BITS, class T>
+class lsd_histograms {
+    static constexpr size_t RADIX_SIZE = radix_digits<RADIX_BITS>::RADIX_SIZE;
+    static constexpr size_t RADIX_LEVELS = radix_digits<RADIX_BITS>::template levels<T>();
+    static constexpr bool ON_STACK = sizeof(size_t[RADIX_LEVELS][RADIX_SIZE]) <= (128 << 10);
+
+    size_t m_stack[ON_STACK ? RADIX_LEVELS : 1][RADIX_SIZE];
+    std::unique_ptr<size_t[][RADIX_SIZE]> m_heap;
+
+public:
+    explicit lsd_histograms(size_t hiPass)
+    {
+        if constexpr (!ON_STACK) {
+            m_heap.reset(new size_t[hiPass][RADIX_SIZE]);
         }
+        memset(get(), 0, hiPass * sizeof(m_stack[0]));
     }
-}
+
+    size_t (*get())[RADIX_SIZE] { return ON_STACK ? m_stack : m_heap.get(); }
+};
 
 // LSD radix sort implementation by Travis, see radix_sort_lsd.h
-template <class T>
+template <size_t RADIX_BITS, scatter_mode MODE = scatter_mode::direct, class T>
 void radix_lsd(T* a, T* queue_area, size_t count, size_t hiPass)
 {
-    constexpr T RADIX_MASK = RADIX_SIZE - 1;
+    constexpr size_t RADIX_SIZE = radix_digits<RADIX_BITS>::RADIX_SIZE;
 
-    freq_array_type freqs = {};
-    count_frequency(a, count, freqs, hiPass);
+    // only the digits below hiPass are needed
+    lsd_histograms<RADIX_BITS, T> histograms(hiPass);
+    size_t(*freqs)[RADIX_SIZE] = histograms.get();
+    count_frequency<RADIX_BITS>(a, count, freqs, hiPass);
 
     T *from = a, *to = queue_area;
 
@@ -55,7 +98,7 @@ void radix_lsd(T* a, T* queue_area, size_t count, size_t hiPass)
             continue;
         }
 
-        T shift = pass * RADIX_BITS;
+        size_t shift = pass * RADIX_BITS;
 
         // array of pointers to the current position in each queue, which we set up based on the
         // known final sizes of each queue (i.e., "tighly packed")
@@ -67,13 +110,7 @@ void radix_lsd(T* a, T* queue_area, size_t count, size_t hiPass)
 
         // copy each element into the appropriate queue based on the current RADIX_BITS sized
         // "digit" within it
-        for (size_t i = 0; i < count; i++) {
-            size_t value = from[i];
-            size_t index = (value >> shift) & RADIX_MASK;
-            *queue_ptrs[index]++ = value;
-            // I don't see impact
-            //__builtin_prefetch(queue_ptrs[index] + 1);
-        }
+        radix_scatter<MODE, RADIX_SIZE>(from, count, queue_ptrs, [shift](T value) -> size_t { return radix_digit<RADIX_BITS>(value, shift); });
 
         // swap from and to areas
         std::swap(from, to);
@@ -86,34 +123,41 @@ void radix_lsd(T* a, T* queue_area, size_t count, size_t hiPass)
     }
 }
 
-// pass <- [7, 0]
-template <class T>
-void radix_msd_rec(std::vector<T>& from, std::vector<T>& to, size_t lo, size_t hi, size_t pass)
+// Sorts from[lo, hi) by the digits [pass, 0] using to[lo, hi) as a scratch area.
+// The sorted range ends up in `to` if intoTo is set and in `from` otherwise: skipping a
+// trivial digit doesn't swap the buffers, so the parity can't be fixed upfront.
+// pass <- [RADIX_LEVELS - 1, 0]
+template <size_t RADIX_BITS, scatter_mode MODE = scatter_mode::direct, class T>
+void radix_msd_rec(T* from, T* to, size_t lo, size_t hi, size_t pass, bool intoTo)
 {
-    constexpr T RADIX_MASK = RADIX_SIZE - 1;
-    auto partFunc = [RADIX_MASK](T v, size_t i) -> T { return (v >> i) & RADIX_MASK; }; // inlined
-    if (hi - lo < 16) { // there will be insertion sort under the hood
-        auto s = &from.front() + lo;
-        auto e = &from.front() + hi;
-        std::stable_sort(s, e);
+    constexpr size_t RADIX_SIZE = radix_digits<RADIX_BITS>::RADIX_SIZE;
+    auto partFunc = [](T v, size_t i) -> size_t { return radix_digit<RADIX_BITS>(v, i); }; // inlined
+    if (hi - lo < small_sort_threshold<RADIX_BITS>()) { // there will be insertion sort under the hood
+        auto s = from + lo;
+        auto e = from + hi;
+        std::stable_sort(s, e, radix_less());
+        if (intoTo)
+            std::copy(s, e, &to[0] + lo);
         return;
     }
 
-    if (hi - lo < LSD_THRESHOLD) {
-        radix_lsd(&from[0] + lo, &to[0] + lo, hi - lo, pass + 1);
+    if (hi - lo < lsd_threshold()) {
+        // the tail fits into the caches, the buffered scatter would only add overhead
+        radix_lsd<RADIX_BITS>(&from[0] + lo, &to[0] + lo, hi - lo, pass + 1);
+        if (intoTo)
+            std::copy(&from[0] + lo, &from[0] + hi, &to[0] + lo);
         return;
     }
 
     size_t shift = pass * RADIX_BITS;
 
-    size_t freq[RADIX_SIZE] = {};
-    for (size_t i = lo; i < hi; ++i) {
-        T value = from[i];
-        ++freq[partFunc(value, shift)];
-    }
+    size_t freq[RADIX_SIZE];
+    count_digit<RADIX_BITS>(&from[0] + lo, hi - lo, shift, freq);
     if (is_trivial(freq, hi - lo)) {
         if (pass != 0) // at least one element to sort
-            radix_msd_rec(from, to, lo, hi, pass - 1);
+            radix_msd_rec<RADIX_BITS, MODE>(from, to, lo, hi, pass - 1, intoTo);
+        else if (intoTo)
+            std::copy(&from[0] + lo, &from[0] + hi, &to[0] + lo);
         return;
     }
 
@@ -122,32 +166,605 @@ void radix_msd_rec(std::vector<T>& from, std::vector<T>& to, size_t lo, size_t h
     for (size_t i = 1; i < RADIX_SIZE; ++i)
         queue_ptrs[i] = queue_ptrs[i - 1] + freq[i - 1];
 
+    auto digit = [shift, partFunc](T value) -> size_t { return partFunc(value, shift); };
+    if (hi - lo < BUFFERED_SCATTER_THRESHOLD) {
+        radix_scatter<scatter_mode::direct, RADIX_SIZE>(&from[0] + lo, hi - lo, queue_ptrs, digit);
+    } else {
+        radix_scatter<MODE, RADIX_SIZE>(&from[0] + lo, hi - lo, queue_ptrs, digit);
+    }
+
+    auto newLo = lo;
+    for (size_t i = 0; i < RADIX_SIZE; ++i) {
+        auto newHi = newLo + freq[i];
+        if (newHi - newLo > 1 && pass != 0) { // at least one element to sort
+            radix_msd_rec<RADIX_BITS, MODE>(to, from, newLo, newHi, pass - 1, !intoTo);
+        } else if (!intoTo) { // the bucket is final but sits in the scratch area
+            std::copy(&to[0] + newLo, &to[0] + newHi, &from[0] + newLo);
+        }
+        newLo = newHi;
+    }
+}
+
+// Out-of-place radix_msd_rec: sorts src[0, count) into dst[0, count) and leaves src untouched.
+// The first scatter reads src, so copying the input costs no separate pass over it, the buckets
+// are then sorted within dst with scratch[0, count) as their buffer.
+template <size_t RADIX_BITS, scatter_mode MODE = scatter_mode::direct, class T>
+void radix_msd_copy(const T* src, T* dst, T* scratch, size_t count, size_t pass)
+{
+    constexpr size_t RADIX_SIZE = radix_digits<RADIX_BITS>::RADIX_SIZE;
+    if (count < lsd_threshold()) {
+        std::copy(src, src + count, dst);
+        radix_msd_rec<RADIX_BITS, MODE>(dst, scratch, 0, count, pass, false);
+        return;
+    }
+
+    size_t shift = pass * RADIX_BITS;
+
+    size_t freq[RADIX_SIZE];
+    count_digit<RADIX_BITS>(src, count, shift, freq);
+    if (is_trivial(freq, count)) {
+        if (pass != 0)
+            radix_msd_copy<RADIX_BITS, MODE>(src, dst, scratch, count, pass - 1);
+        else
+            std::copy(src, src + count, dst);
+        return;
+    }
+
+    T* queue_ptrs[RADIX_SIZE];
+    queue_ptrs[0] = dst;
+    for (size_t i = 1; i < RADIX_SIZE; ++i)
+        queue_ptrs[i] = queue_ptrs[i - 1] + freq[i - 1];
+
+    auto digit = [shift](T value) -> size_t { return radix_digit<RADIX_BITS>(value, shift); };
+    if (count < BUFFERED_SCATTER_THRESHOLD) {
+        radix_scatter<scatter_mode::direct, RADIX_SIZE>(src, count, queue_ptrs, digit);
+    } else {
+        radix_scatter<MODE, RADIX_SIZE>(src, count, queue_ptrs, digit);
+    }
+
+    size_t newLo = 0;
+    for (size_t i = 0; i < RADIX_SIZE; ++i) {
+        size_t newHi = newLo + freq[i];
+        if (newHi - newLo > 1 && pass != 0) {
+            radix_msd_rec<RADIX_BITS, MODE>(dst, scratch, newLo, newHi, pass - 1, false);
+        }
+        newLo = newHi;
+    }
+}
+
+
+// Key/index version of radix_lsd: the index payload travels with the key through
+// every scatter, so equal keys keep the order of their indices.
+template <size_t RADIX_BITS, class T, class I>
+void radix_lsd_indices(T* a, I* idx, T* queue_area, I* idx_queue_area, size_t count, size_t hiPass)
+{
+    constexpr size_t RADIX_SIZE = radix_digits<RADIX_BITS>::RADIX_SIZE;
+
+    lsd_histograms<RADIX_BITS, T> histograms(hiPass);
+    size_t(*freqs)[RADIX_SIZE] = histograms.get();
+    count_frequency<RADIX_BITS>(a, count, freqs, hiPass);
+
+    T *from = a, *to = queue_area;
+    I *idxFrom = idx, *idxTo = idx_queue_area;
+
+    for (size_t pass = 0; pass < hiPass; pass++) {
+
+        if (is_trivial(freqs[pass], count)) {
+            continue;
+        }
+
+        size_t shift = pass * RADIX_BITS;
+
+        size_t offsets[RADIX_SIZE], next = 0;
+        for (size_t i = 0; i < RADIX_SIZE; i++) {
+            offsets[i] = next;
+            next += freqs[pass][i];
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            T value = from[i];
+            size_t pos = offsets[radix_digit<RADIX_BITS>(value, shift)]++;
+            to[pos] = value;
+            idxTo[pos] = idxFrom[i];
+        }
+
+        std::swap(from, to);
+        std::swap(idxFrom, idxTo);
+    }
+
+    if (from != a) {
+        std::copy(from, from + count, a);
+        std::copy(idxFrom, idxFrom + count, idx);
+    }
+}
+
+// Stable insertion sort of the key/index pairs, used for the tiny buckets.
+template <class T, class I>
+void insertion_sort_indices(T* a, I* idx, size_t count)
+{
+    for (size_t i = 1; i < count; ++i) {
+        T value = a[i];
+        I index = idx[i];
+        size_t j = i;
+        for (; j > 0 && radix_less()(value, a[j - 1]); --j) {
+            a[j] = a[j - 1];
+            idx[j] = idx[j - 1];
+        }
+        a[j] = value;
+        idx[j] = index;
+    }
+}
+
+// Same as radix_msd_rec, but the keys are accompanied by the index payload.
+template <size_t RADIX_BITS, class T, class I>
+void radix_msd_rec_indices(T* from, I* idxFrom, T* to, I* idxTo, size_t lo, size_t hi, size_t pass, bool intoTo)
+{
+    constexpr size_t RADIX_SIZE = radix_digits<RADIX_BITS>::RADIX_SIZE;
+    auto partFunc = [](T v, size_t i) -> size_t { return radix_digit<RADIX_BITS>(v, i); };
+    auto moveToDst = [&](size_t lo, size_t hi) {
+        std::copy(&from[0] + lo, &from[0] + hi, &to[0] + lo);
+        std::copy(&idxFrom[0] + lo, &idxFrom[0] + hi, &idxTo[0] + lo);
+    };
+
+    if (hi - lo < small_sort_threshold<RADIX_BITS>()) {
+        insertion_sort_indices(&from[0] + lo, &idxFrom[0] + lo, hi - lo);
+        if (intoTo)
+            moveToDst(lo, hi);
+        return;
+    }
+
+    if (hi - lo < lsd_threshold()) {
+        radix_lsd_indices<RADIX_BITS>(&from[0] + lo, &idxFrom[0] + lo, &to[0] + lo, &idxTo[0] + lo, hi - lo, pass + 1);
+        if (intoTo)
+            moveToDst(lo, hi);
+        return;
+    }
+
+    size_t shift = pass * RADIX_BITS;
+
+    size_t freq[RADIX_SIZE];
+    count_digit<RADIX_BITS>(&from[0] + lo, hi - lo, shift, freq);
+    if (is_trivial(freq, hi - lo)) {
+        if (pass != 0)
+            radix_msd_rec_indices<RADIX_BITS>(from, idxFrom, to, idxTo, lo, hi, pass - 1, intoTo);
+        else if (intoTo)
+            moveToDst(lo, hi);
+        return;
+    }
+
+    size_t offsets[RADIX_SIZE];
+    offsets[0] = lo;
+    for (size_t i = 1; i < RADIX_SIZE; ++i)
+        offsets[i] = offsets[i - 1] + freq[i - 1];
+
     for (size_t i = lo; i < hi; ++i) {
         T value = from[i];
-        size_t index = partFunc(value, shift);
-        *queue_ptrs[index] = value;
-        ++queue_ptrs[index];
+        size_t pos = offsets[partFunc(value, shift)]++;
+        to[pos] = value;
+        idxTo[pos] = idxFrom[i];
     }
 
     auto newLo = lo;
-    auto newHi = lo + freq[0];
-    for (size_t i = 1; i < RADIX_SIZE; ++i) {
-        if (newHi - newLo > 1 && pass != 0) { // at least one element to sort
-            radix_msd_rec(to, from, newLo, newHi, pass - 1);
+    for (size_t i = 0; i < RADIX_SIZE; ++i) {
+        auto newHi = newLo + freq[i];
+        if (newHi - newLo > 1 && pass != 0) {
+            radix_msd_rec_indices<RADIX_BITS>(to, idxTo, from, idxFrom, newLo, newHi, pass - 1, !intoTo);
+        } else if (!intoTo) {
+            std::copy(&to[0] + newLo, &to[0] + newHi, &from[0] + newLo);
+            std::copy(&idxTo[0] + newLo, &idxTo[0] + newHi, &idxFrom[0] + newLo);
         }
         newLo = newHi;
-        newHi += freq[i];
     }
-    if (newHi - newLo > 1 && pass != 0)
-        radix_msd_rec(to, from, newLo, newHi, pass - 1);
 }
+
+// below this size a bucket is sorted by the serial radix_msd_rec within a single task
+const size_t PARALLEL_TASK_THRESHOLD = 1 << 16;
+
+// Histogram and scatter of from[lo, hi) by the digit at `shift` into to[lo, hi) split into chunks
+// processed by the pool: every chunk counts its part, the counts are prefix-summed bucket by bucket
+// across the chunks and every chunk scatters into its own disjoint ranges, so the scatter is stable.
+// freq receives the total size of every bucket.
+template <size_t RADIX_BITS, class T>
+void parallel_partition(work_stealing_pool& pool, const T* from, T* to, size_t lo, size_t hi,
+    size_t shift, size_t (&freq)[radix_digits<RADIX_BITS>::RADIX_SIZE])
+{
+    constexpr size_t RADIX_SIZE = radix_digits<RADIX_BITS>::RADIX_SIZE;
+    const size_t numChunks = std::max<size_t>(1, std::min(pool.size(), (hi - lo) / PARALLEL_TASK_THRESHOLD));
+    auto chunkBegin = [lo, hi, numChunks](size_t c) { return lo + (hi - lo) * c / numChunks; };
+    std::unique_ptr<size_t[][RADIX_SIZE]> counts(new size_t[numChunks][RADIX_SIZE]());
+
+    task_group group;
+    for (size_t c = 0; c < numChunks; ++c) {
+        pool.submit(group, [&, c] {
+            for (size_t i = chunkBegin(c), e = chunkBegin(c + 1); i < e; ++i) {
+                ++counts[c][radix_digit<RADIX_BITS>(from[i], shift)];
+            }
+        });
+    }
+    pool.wait(group);
+
+    size_t next = lo;
+    for (size_t i = 0; i < RADIX_SIZE; ++i) {
+        freq[i] = 0;
+        for (size_t c = 0; c < numChunks; ++c) {
+            size_t count = counts[c][i];
+            counts[c][i] = next;
+            next += count;
+            freq[i] += count;
+        }
+    }
+    if (is_trivial(freq, hi - lo)) {
+        return; // the caller doesn't need the scatter
+    }
+
+    for (size_t c = 0; c < numChunks; ++c) {
+        pool.submit(group, [&, c] {
+            T* queue_ptrs[RADIX_SIZE];
+            for (size_t i = 0; i < RADIX_SIZE; ++i)
+                queue_ptrs[i] = &to[0] + counts[c][i];
+            for (size_t i = chunkBegin(c), e = chunkBegin(c + 1); i < e; ++i) {
+                T value = from[i];
+                *queue_ptrs[radix_digit<RADIX_BITS>(value, shift)]++ = value;
+            }
+        });
+    }
+    pool.wait(group);
 }
 
+// scan_keys of the whole data, every thread scans a chunk
 template <class T>
+key_scan<T> parallel_scan_keys(work_stealing_pool& pool, const T* data, size_t count)
+{
+    const size_t numChunks = pool.size();
+    std::vector<key_scan<T>> scans(numChunks);
+    task_group group;
+    for (size_t c = 0; c < numChunks; ++c) {
+        pool.submit(group, [&, c] {
+            const size_t lo = count * c / numChunks, hi = count * (c + 1) / numChunks;
+            scans[c] = scan_keys(data, lo, hi);
+        });
+    }
+    pool.wait(group);
+    key_scan<T> total;
+    for (size_t c = 0; c < numChunks; ++c) {
+        total.add(scans[c]);
+    }
+    return total;
+}
+
+// Parallel counterpart of radix_msd_rec: the large ranges are partitioned by the whole pool and
+// every bucket becomes a task of `group`, so a skewed distribution still spreads over the threads.
+template <size_t RADIX_BITS, class T>
+void radix_msd_rec_parallel(work_stealing_pool& pool, task_group& group, T* from, T* to, size_t lo, size_t hi,
+    size_t pass, bool intoTo)
+{
+    constexpr size_t RADIX_SIZE = radix_digits<RADIX_BITS>::RADIX_SIZE;
+    if (hi - lo < PARALLEL_TASK_THRESHOLD) {
+        radix_msd_rec<RADIX_BITS>(from, to, lo, hi, pass, intoTo);
+        return;
+    }
+
+    size_t freq[RADIX_SIZE];
+    parallel_partition<RADIX_BITS>(pool, from, to, lo, hi, pass * RADIX_BITS, freq);
+    if (is_trivial(freq, hi - lo)) {
+        if (pass != 0)
+            radix_msd_rec_parallel<RADIX_BITS>(pool, group, from, to, lo, hi, pass - 1, intoTo);
+        else if (intoTo)
+            std::copy(&from[0] + lo, &from[0] + hi, &to[0] + lo);
+        return;
+    }
+
+    auto newLo = lo;
+    for (size_t i = 0; i < RADIX_SIZE; ++i) {
+        auto newHi = newLo + freq[i];
+        if (newHi - newLo > 1 && pass != 0) {
+            pool.submit(group, [&pool, &group, from, to, newLo, newHi, pass, intoTo] {
+                radix_msd_rec_parallel<RADIX_BITS>(pool, group, to, from, newLo, newHi, pass - 1, !intoTo);
+            });
+        } else if (!intoTo) {
+            std::copy(&to[0] + newLo, &to[0] + newHi, &from[0] + newLo);
+        }
+        newLo = newHi;
+    }
+}
+}
+
+// RADIX_BITS is the digit width (see radix_digits.h), MODE selects the scatter kernel (see radix_scatter.h)
+// The nearly sorted inputs take the fast paths of radix_presorted.h instead of the radix passes.
+// scratch is the buffer of the sort, radix_sort_scratch_size(count) elements: a caller which keeps
+// it between the calls sorts without allocating.
+template <size_t RADIX_BITS = 8, scatter_mode MODE = scatter_mode::direct, class T>
+void radix_sort_hybrid(T* data, size_t count, T* scratch)
+{
+    details::check_digit_width<RADIX_BITS>();
+    if constexpr (is_counting_sortable<T>()) {
+        counting_sort(data, count, data);
+        return;
+    }
+    if constexpr (is_wide_key<T>()) {
+        if (sort_low_words(data, count, [scratch] { return scratch; },
+                [](auto* words, size_t wordCount, auto* buffer) { radix_sort_hybrid<RADIX_BITS, MODE>(words, wordCount, buffer); })) {
+            return; // the high words don't take part in the order, see radix_wide_keys.h
+        }
+    }
+    const auto scan = scan_keys(data, 0, count);
+    if (sort_presorted(data, count, scan, [scratch] { return scratch; },
+            [scratch](T* side, size_t sideCount) { radix_sort_hybrid<RADIX_BITS, MODE>(side, sideCount, scratch); })) {
+        return; // sorted, descending, a few runs or a few outliers; all the keys equal is sorted too
+    }
+    details::radix_msd_rec<RADIX_BITS, MODE>(data, scratch, 0, count, radix_digits<RADIX_BITS>::top_level(scan.varying()), false);
+}
+
+template <size_t RADIX_BITS = 8, scatter_mode MODE = scatter_mode::direct, class T>
+void radix_sort_hybrid(T* data, size_t count)
+{
+    if constexpr (is_counting_sortable<T>()) {
+        counting_sort(data, count, data);
+        return;
+    }
+    // not a std::vector, which would zero it first, and only allocated when the keys aren't sorted
+    std::unique_ptr<T[]> scratch;
+    auto getScratch = [&scratch, count] {
+        if (!scratch)
+            scratch.reset(new T[radix_sort_scratch_size<T>(count)]);
+        return scratch.get();
+    };
+
+    details::check_digit_width<RADIX_BITS>();
+    if constexpr (is_wide_key<T>()) {
+        if (sort_low_words(data, count, getScratch,
+                [](auto* words, size_t wordCount, auto* buffer) { radix_sort_hybrid<RADIX_BITS, MODE>(words, wordCount, buffer); })) {
+            return;
+        }
+    }
+    const auto scan = scan_keys(data, 0, count);
+    if (sort_presorted(data, count, scan, getScratch,
+            [&getScratch](T* side, size_t sideCount) { radix_sort_hybrid<RADIX_BITS, MODE>(side, sideCount, getScratch()); })) {
+        return;
+    }
+    details::radix_msd_rec<RADIX_BITS, MODE>(data, getScratch(), 0, count, radix_digits<RADIX_BITS>::top_level(scan.varying()), false);
+}
+
+// std::vector front ends, scratch is grown to radix_sort_scratch_size if it is smaller
+template <size_t RADIX_BITS = 8, scatter_mode MODE = scatter_mode::direct, class T>
+void radix_sort_hybrid(std::vector<T>& data, std::vector<T>& scratch)
+{
+    if (scratch.size() < radix_sort_scratch_size<T>(data.size())) {
+        scratch.resize(radix_sort_scratch_size<T>(data.size()));
+    }
+    radix_sort_hybrid<RADIX_BITS, MODE>(data.data(), data.size(), scratch.data());
+}
+
+template <size_t RADIX_BITS = 8, scatter_mode MODE = scatter_mode::direct, class T>
 void radix_sort_hybrid(std::vector<T>& data)
 {
-    std::vector<T> buf(data.size());
-    details::radix_msd_rec(data, buf, 0, data.size(), details::RADIX_LEVELS - 1);
-    if (details::DO_FINAL_SWAP)
-        swap(data, buf);
+    radix_sort_hybrid<RADIX_BITS, MODE>(data.data(), data.size());
+}
+
+// radix_sort_hybrid with the digit width of the tuning profile, see radix_tuning.h
+template <class T>
+void radix_sort_hybrid_tuned(T* data, size_t count, T* scratch)
+{
+    if (radix_tuning_profile().radixBits == 11)
+        radix_sort_hybrid<11>(data, count, scratch);
+    else
+        radix_sort_hybrid<8>(data, count, scratch);
+}
+
+template <class T>
+void radix_sort_hybrid_tuned(T* data, size_t count)
+{
+    if (radix_tuning_profile().radixBits == 11)
+        radix_sort_hybrid<11>(data, count);
+    else
+        radix_sort_hybrid<8>(data, count);
+}
+
+/**
+ * Out-of-place radix_sort_hybrid: sorts src[0, count) into dst[0, count), src is only read, so it
+ * may be a foreign or read-only buffer. The copy is folded into the first scatter. scratch is
+ * radix_sort_scratch_size(count) elements.
+ */
+template <size_t RADIX_BITS = 8, scatter_mode MODE = scatter_mode::direct, class T>
+void radix_sort_hybrid_copy(const T* src, size_t count, T* dst, T* scratch)
+{
+    details::check_digit_width<RADIX_BITS>();
+    if constexpr (is_counting_sortable<T>()) {
+        counting_sort(src, count, dst);
+        return;
+    }
+    const auto scan = scan_keys(src, 0, count);
+    if (is_presorted(scan, count)) {
+        // the fast paths are passes over dst anyway
+        std::copy(src, src + count, dst);
+        radix_sort_hybrid<RADIX_BITS, MODE>(dst, count, scratch);
+        return;
+    }
+    details::radix_msd_copy<RADIX_BITS, MODE>(src, dst, scratch, count, radix_digits<RADIX_BITS>::top_level(scan.varying()));
+}
+
+template <size_t RADIX_BITS = 8, scatter_mode MODE = scatter_mode::direct, class T>
+void radix_sort_hybrid_copy(const T* src, size_t count, T* dst)
+{
+    std::unique_ptr<T[]> scratch(new T[radix_sort_scratch_size<T>(count)]);
+    radix_sort_hybrid_copy<RADIX_BITS, MODE>(src, count, dst, scratch.get());
+}
+
+/**
+ * radix_sort_hybrid of a nullable column (see radix_nulls.h): sorts the values and groups the
+ * nulls at the start or at the end, `validity` is rewritten to match. The pass which scans the
+ * keys also compacts the values into the scratch, and the sort moves them back into their slots,
+ * instead of compacting, sorting and reinserting them in separate passes. Returns the number of
+ * nulls. scratch is radix_sort_scratch_size(count) elements.
+ */
+template <size_t RADIX_BITS = 8, scatter_mode MODE = scatter_mode::direct, class T>
+size_t radix_sort_hybrid(T* data, size_t count, uint8_t* validity, null_placement placement, T* scratch)
+{
+    details::check_digit_width<RADIX_BITS>();
+    const size_t nullCount = count_nulls(validity, count);
+    if (nullCount == 0) {
+        radix_sort_hybrid<RADIX_BITS, MODE>(data, count, scratch);
+        return 0;
+    }
+    const null_layout layout(count, nullCount, placement);
+    const size_t validCount = count - nullCount;
+    const auto scan = compact_valid_keys(data, count, validity, scratch);
+    if (validCount > 1 && scan.varying() != 0) {
+        // data is free now, the values land in their slots and the rest of them is the buffer
+        details::radix_msd_rec<RADIX_BITS, MODE>(scratch, data + layout.validBegin, 0, validCount,
+            radix_digits<RADIX_BITS>::top_level(scan.varying()), true);
+    } else {
+        std::copy(scratch, scratch + validCount, data + layout.validBegin);
+    }
+    layout.write(validity, count);
+    return nullCount;
+}
+
+template <size_t RADIX_BITS = 8, scatter_mode MODE = scatter_mode::direct, class T>
+size_t radix_sort_hybrid(T* data, size_t count, uint8_t* validity, null_placement placement)
+{
+    std::unique_ptr<T[]> scratch(new T[radix_sort_scratch_size<T>(count)]);
+    return radix_sort_hybrid<RADIX_BITS, MODE>(data, count, validity, placement, scratch.get());
+}
+
+// The buffers of radix_argsort_hybrid, see radix_sort_hybrid(data, count, scratch).
+template <class T, class I = uint32_t>
+struct argsort_scratch {
+    std::vector<T> keys;
+    std::vector<T> keysBuf;
+    std::vector<I> indicesBuf;
+
+    // allocates the buffers for `count` keys upfront
+    void reserve(size_t count)
+    {
+        if (keys.size() < count) {
+            keys.resize(count);
+            keysBuf.resize(count);
+            indicesBuf.resize(count);
+        }
+    }
+};
+
+// Stable argsort, the counterpart of Arrow's sort_indices: fills indices[0, count) with the
+// permutation which sorts data[0, count), equal keys keep their original relative order. `data`
+// is left untouched. I is the index type, uint32_t is enough for up to 4G rows and halves the
+// payload traffic.
+template <size_t RADIX_BITS = 8, class T, class I>
+void radix_argsort_hybrid(const T* data, size_t count, I* indices, argsort_scratch<T, I>& scratch)
+{
+    details::check_digit_width<RADIX_BITS>();
+    static_assert(std::is_unsigned<I>::value && (sizeof(I) == 4 || sizeof(I) == 8), "I must be uint32_t or uint64_t");
+    assert(count <= (size_t)std::numeric_limits<I>::max());
+
+    for (size_t i = 0; i < count; ++i)
+        indices[i] = (I)i;
+
+    const auto scan = scan_keys(data, 0, count);
+    if (scan.descents == 0) {
+        return; // sorted or all the keys equal, the identity is the stable order
+    }
+    if (scan.ascents == 0) {
+        presorted::descending_indices(data, indices, count);
+        return;
+    }
+    scratch.reserve(count);
+    std::copy(data, data + count, scratch.keys.data());
+    details::radix_msd_rec_indices<RADIX_BITS>(scratch.keys.data(), indices, scratch.keysBuf.data(), scratch.indicesBuf.data(), 0, count,
+        radix_digits<RADIX_BITS>::top_level(scan.varying()), false);
+}
+
+template <size_t RADIX_BITS = 8, class T, class I>
+void radix_argsort_hybrid(const std::vector<T>& data, std::vector<I>& indices, argsort_scratch<T, I>& scratch)
+{
+    indices.resize(data.size());
+    radix_argsort_hybrid<RADIX_BITS>(data.data(), data.size(), indices.data(), scratch);
+}
+
+template <size_t RADIX_BITS = 8, class T, class I = uint32_t>
+void radix_argsort_hybrid(const std::vector<T>& data, std::vector<I>& indices)
+{
+    argsort_scratch<T, I> scratch;
+    radix_argsort_hybrid<RADIX_BITS>(data, indices, scratch);
+}
+
+/**
+ * radix_argsort_hybrid of a nullable column (see radix_nulls.h): the indices of the nulls go to
+ * the start or the end in their original order, the ones of the values follow the stable order of
+ * the values. The pass which copies the keys into the scratch also compacts out the nulls.
+ * Returns the number of nulls.
+ */
+template <size_t RADIX_BITS = 8, class T, class I>
+size_t radix_argsort_hybrid(const T* data, size_t count, const uint8_t* validity, null_placement placement, I* indices,
+    argsort_scratch<T, I>& scratch)
+{
+    using K = radix_key_t<T>;
+    const size_t nullCount = count_nulls(validity, count);
+    if (nullCount == 0) {
+        radix_argsort_hybrid<RADIX_BITS>(data, count, indices, scratch);
+        return 0;
+    }
+    details::check_digit_width<RADIX_BITS>();
+    assert(count <= (size_t)std::numeric_limits<I>::max());
+
+    const null_layout layout(count, nullCount, placement);
+    scratch.reserve(count - nullCount);
+    T* keys = scratch.keys.data();
+    I *valid = indices + layout.validBegin, *nulls = indices + layout.nullsBegin;
+    K orAll = 0, andAll = ~(K)0;
+    size_t n = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (is_valid(validity, i)) {
+            orAll |= radix_key(data[i]);
+            andAll &= radix_key(data[i]);
+            keys[n] = data[i];
+            valid[n++] = (I)i;
+        } else {
+            *nulls++ = (I)i;
+        }
+    }
+    if (n > 1 && (orAll ^ andAll) != 0) {
+        details::radix_msd_rec_indices<RADIX_BITS>(keys, valid, scratch.keysBuf.data(), scratch.indicesBuf.data(), 0, n,
+            radix_digits<RADIX_BITS>::top_level(orAll ^ andAll), false);
+    }
+    return nullCount;
+}
+
+template <size_t RADIX_BITS = 8, class T, class I>
+size_t radix_argsort_hybrid(const T* data, size_t count, const uint8_t* validity, null_placement placement, I* indices)
+{
+    argsort_scratch<T, I> scratch;
+    return radix_argsort_hybrid<RADIX_BITS>(data, count, validity, placement, indices, scratch);
+}
+
+// Multi-threaded radix_sort_hybrid: the top level partition runs on all the threads and then the
+// bucket recursions, down to the radix_lsd tails, are scheduled on a work-stealing pool.
+template <size_t RADIX_BITS = 8, class T>
+void radix_sort_hybrid_parallel(T* data, size_t count, size_t numThreads = std::thread::hardware_concurrency())
+{
+    if (numThreads <= 1 || count < 2 * details::PARALLEL_TASK_THRESHOLD || is_counting_sortable<T>()) {
+        radix_sort_hybrid<RADIX_BITS>(data, count);
+        return;
+    }
+
+    work_stealing_pool pool(numThreads);
+    const auto scan = details::parallel_scan_keys(pool, data, count);
+    std::unique_ptr<T[]> buf;
+    auto getScratch = [&buf, count] {
+        if (!buf)
+            buf.reset(new T[radix_sort_scratch_size<T>(count)]);
+        return buf.get();
+    };
+    if (sort_presorted(data, count, scan, getScratch,
+            [&getScratch](T* side, size_t sideCount) { radix_sort_hybrid<RADIX_BITS>(side, sideCount, getScratch()); })) {
+        return;
+    }
+    task_group group;
+    details::radix_msd_rec_parallel<RADIX_BITS>(pool, group, data, getScratch(), 0, count, radix_digits<RADIX_BITS>::top_level(scan.varying()), false);
+    pool.wait(group);
+}
+
+template <size_t RADIX_BITS = 8, class T>
+void radix_sort_hybrid_parallel(std::vector<T>& data, size_t numThreads = std::thread::hardware_concurrency())
+{
+    radix_sort_hybrid_parallel<RADIX_BITS>(data.data(), data.size(), numThreads);
 }
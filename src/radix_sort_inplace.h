@@ -0,0 +1,344 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+
+#include "radix_digits.h"
+#include "radix_histogram.h"
+#include "radix_sort_hybrid.h"
+#include "work_stealing_pool.h"
+
+namespace inplace_impl {
+// below this size std::sort beats a pass over RADIX_SIZE buckets
+const size_t SMALL_SORT_THRESHOLD = 128;
+
+// Moves the elements of a[0, count) to their buckets by following the permutation cycles
+// (American flag sort): heads[b] is the first misplaced slot of the bucket b, the element found
+// there is swapped to the head of its own bucket until an element of b turns up.
+template <size_t RADIX_BITS, class T>
+void permute(T* a, size_t shift, const size_t (&freq)[radix_digits<RADIX_BITS>::RADIX_SIZE])
+{
+    constexpr size_t RADIX_SIZE = radix_digits<RADIX_BITS>::RADIX_SIZE;
+
+    size_t heads[RADIX_SIZE], tails[RADIX_SIZE];
+    size_t next = 0;
+    for (size_t i = 0; i < RADIX_SIZE; ++i) {
+        heads[i] = next;
+        next += freq[i];
+        tails[i] = next;
+    }
+
+    for (size_t b = 0; b < RADIX_SIZE; ++b) {
+        while (heads[b] < tails[b]) {
+            T value = a[heads[b]];
+            size_t index = radix_digit<RADIX_BITS>(value, shift);
+            while (index != b) {
+                std::swap(value, a[heads[index]++]);
+                index = radix_digit<RADIX_BITS>(value, shift);
+            }
+            a[heads[b]++] = value;
+        }
+    }
+}
+
+// pass <- [RADIX_LEVELS - 1, 0]
+template <size_t RADIX_BITS, class T>
+void radix_inplace_rec(T* a, size_t count, size_t pass)
+{
+    constexpr size_t RADIX_SIZE = radix_digits<RADIX_BITS>::RADIX_SIZE;
+    if (count < SMALL_SORT_THRESHOLD) {
+        std::sort(a, a + count, radix_less());
+        return;
+    }
+
+    const size_t shift = pass * RADIX_BITS;
+    size_t freq[RADIX_SIZE];
+    count_digit<RADIX_BITS>(a, count, shift, freq);
+    if (details::is_trivial(freq, count)) {
+        if (pass != 0)
+            radix_inplace_rec<RADIX_BITS>(a, count, pass - 1);
+        return;
+    }
+
+    permute<RADIX_BITS>(a, shift, freq);
+
+    if (pass == 0)
+        return;
+    size_t lo = 0;
+    for (size_t i = 0; i < RADIX_SIZE; ++i) {
+        if (freq[i] > 1)
+            radix_inplace_rec<RADIX_BITS>(a + lo, freq[i], pass - 1);
+        lo += freq[i];
+    }
+}
+
+// The buckets are independent tasks of the pool, the ones large enough to be worth it count
+// their histogram in parallel. The cycle permutation itself stays serial: splitting it between
+// the threads needs a repair phase for the elements left behind (PARADIS), which we don't have.
+template <size_t RADIX_BITS, class T>
+void radix_inplace_rec_parallel(work_stealing_pool& pool, task_group& group, T* a, size_t count, size_t pass)
+{
+    constexpr size_t RADIX_SIZE = radix_digits<RADIX_BITS>::RADIX_SIZE;
+    if (count < details::PARALLEL_TASK_THRESHOLD) {
+        radix_inplace_rec<RADIX_BITS>(a, count, pass);
+        return;
+    }
+
+    const size_t shift = pass * RADIX_BITS;
+    const size_t numChunks = std::max<size_t>(1, std::min(pool.size(), count / details::PARALLEL_TASK_THRESHOLD));
+    std::unique_ptr<size_t[][RADIX_SIZE]> counts(new size_t[numChunks][RADIX_SIZE]);
+    task_group chunks;
+    for (size_t c = 0; c < numChunks; ++c) {
+        pool.submit(chunks, [&, c] {
+            const size_t lo = count * c / numChunks, hi = count * (c + 1) / numChunks;
+            count_digit<RADIX_BITS>(a + lo, hi - lo, shift, counts[c]);
+        });
+    }
+    pool.wait(chunks);
+
+    size_t freq[RADIX_SIZE] = {};
+    for (size_t c = 0; c < numChunks; ++c)
+        for (size_t i = 0; i < RADIX_SIZE; ++i)
+            freq[i] += counts[c][i];
+    if (details::is_trivial(freq, count)) {
+        if (pass != 0)
+            radix_inplace_rec_parallel<RADIX_BITS>(pool, group, a, count, pass - 1);
+        return;
+    }
+
+    permute<RADIX_BITS>(a, shift, freq);
+
+    if (pass == 0)
+        return;
+    size_t lo = 0;
+    for (size_t i = 0; i < RADIX_SIZE; ++i) {
+        if (freq[i] > 1) {
+            T* bucket = a + lo;
+            size_t size = freq[i];
+            pool.submit(group, [&pool, &group, bucket, size, pass] {
+                radix_inplace_rec_parallel<RADIX_BITS>(pool, group, bucket, size, pass - 1);
+            });
+        }
+        lo += freq[i];
+    }
+}
+
+// Stable merge of the sorted [first, middle) and [middle, last) using at most bufSize elements
+// of buf: the runs which don't fit are split and rotated into place, as std::inplace_merge does
+// when it can't get a buffer.
+template <class T>
+void merge_bounded(T* first, T* middle, T* last, T* buf, size_t bufSize)
+{
+    const size_t len1 = middle - first, len2 = last - middle;
+    const radix_less less;
+    if (len1 == 0 || len2 == 0 || !less(*middle, *(middle - 1))) {
+        return;
+    }
+
+    if (len1 <= bufSize && len1 <= len2) {
+        T* bufEnd = std::copy(first, middle, buf);
+        T *out = first, *l = buf, *r = middle;
+        while (l != bufEnd && r != last) {
+            *out++ = less(*r, *l) ? *r++ : *l++;
+        }
+        std::copy(l, bufEnd, out);
+        return;
+    }
+    if (len2 <= bufSize) {
+        T* bufEnd = std::copy(middle, last, buf);
+        T *out = last, *l = middle, *r = bufEnd;
+        while (l != first && r != buf) {
+            *--out = less(*(r - 1), *(l - 1)) ? *--l : *--r;
+        }
+        std::copy_backward(buf, r, out);
+        return;
+    }
+
+    T *cut1, *cut2;
+    if (len1 > len2) {
+        cut1 = first + len1 / 2;
+        cut2 = std::lower_bound(middle, last, *cut1, less);
+    } else {
+        cut2 = middle + len2 / 2;
+        cut1 = std::upper_bound(first, middle, *cut2, less);
+    }
+    T* newMiddle = std::rotate(cut1, middle, cut2);
+    merge_bounded(first, cut1, newMiddle, buf, bufSize);
+    merge_bounded(newMiddle, cut2, last, buf, bufSize);
+}
+
+// Same as merge_bounded, but the payload values[first, last) is moved along with the keys.
+template <class T, class I>
+void merge_bounded_indices(T* a, I* idx, size_t first, size_t middle, size_t last, T* buf, I* idxBuf, size_t bufSize)
+{
+    const size_t len1 = middle - first, len2 = last - middle;
+    const radix_less less;
+    if (len1 == 0 || len2 == 0 || !less(a[middle], a[middle - 1])) {
+        return;
+    }
+
+    if (len1 <= bufSize && len1 <= len2) {
+        std::copy(a + first, a + middle, buf);
+        std::copy(idx + first, idx + middle, idxBuf);
+        size_t out = first, l = 0, r = middle;
+        while (l != len1 && r != last) {
+            if (less(a[r], buf[l])) {
+                a[out] = a[r];
+                idx[out++] = idx[r++];
+            } else {
+                a[out] = buf[l];
+                idx[out++] = idxBuf[l++];
+            }
+        }
+        std::copy(buf + l, buf + len1, a + out);
+        std::copy(idxBuf + l, idxBuf + len1, idx + out);
+        return;
+    }
+    if (len2 <= bufSize) {
+        std::copy(a + middle, a + last, buf);
+        std::copy(idx + middle, idx + last, idxBuf);
+        size_t out = last, l = middle, r = len2;
+        while (l != first && r != 0) {
+            if (less(buf[r - 1], a[l - 1])) {
+                a[--out] = a[--l];
+                idx[out] = idx[l];
+            } else {
+                a[--out] = buf[--r];
+                idx[out] = idxBuf[r];
+            }
+        }
+        std::copy_backward(buf, buf + r, a + out);
+        std::copy_backward(idxBuf, idxBuf + r, idx + out);
+        return;
+    }
+
+    size_t cut1, cut2;
+    if (len1 > len2) {
+        cut1 = first + len1 / 2;
+        cut2 = std::lower_bound(a + middle, a + last, a[cut1], less) - a;
+    } else {
+        cut2 = middle + len2 / 2;
+        cut1 = std::upper_bound(a + first, a + middle, a[cut2], less) - a;
+    }
+    std::rotate(a + cut1, a + middle, a + cut2);
+    std::rotate(idx + cut1, idx + middle, idx + cut2);
+    const size_t newMiddle = cut1 + (cut2 - middle);
+    merge_bounded_indices(a, idx, first, cut1, newMiddle, buf, idxBuf, bufSize);
+    merge_bounded_indices(a, idx, newMiddle, cut2, last, buf, idxBuf, bufSize);
+}
+}
+
+/**
+ * In-place MSD radix sort (American flag sort): the elements are permuted within `a` along the
+ * bucket cycles, so the only memory besides the input are the per-level histograms on the stack.
+ * Not stable, see radix_sort_inplace_stable.
+ */
+template <size_t RADIX_BITS = 8, class T>
+void radix_sort_inplace(T* a, size_t count)
+{
+    details::check_digit_width<RADIX_BITS>();
+    if constexpr (is_counting_sortable<T>()) {
+        counting_sort(a, count, a); // in place as well, the histogram is all it keeps
+        return;
+    }
+    const auto varying = varying_bits(a, count);
+    if (varying == 0) {
+        return;
+    }
+    inplace_impl::radix_inplace_rec<RADIX_BITS>(a, count, radix_digits<RADIX_BITS>::top_level(varying));
+}
+
+// Multi-threaded radix_sort_inplace, the buckets are sorted on a work-stealing pool.
+template <size_t RADIX_BITS = 8, class T>
+void radix_sort_inplace_parallel(T* a, size_t count, size_t numThreads = std::thread::hardware_concurrency())
+{
+    details::check_digit_width<RADIX_BITS>();
+    if (numThreads <= 1 || count < 2 * details::PARALLEL_TASK_THRESHOLD || is_counting_sortable<T>()) {
+        radix_sort_inplace<RADIX_BITS>(a, count);
+        return;
+    }
+
+    const auto varying = varying_bits(a, count);
+    if (varying == 0) {
+        return;
+    }
+    work_stealing_pool pool(numThreads);
+    task_group group;
+    inplace_impl::radix_inplace_rec_parallel<RADIX_BITS>(pool, group, a, count, radix_digits<RADIX_BITS>::top_level(varying));
+    pool.wait(group);
+}
+
+// default scratch of radix_sort_inplace_stable, 512K of 64-bit keys
+const size_t INPLACE_STABLE_SCRATCH = 1 << 16;
+
+/**
+ * Stable sort using at most `scratchSize` elements of scratch memory instead of an O(n) buffer.
+ *
+ * Blocks of scratchSize elements are sorted by the LSD radix sort with the scratch as its buffer,
+ * then the sorted blocks are merged bottom-up by a merge which only buffers what fits into the
+ * scratch and rotates the rest. The merges make it O(n log(n / scratchSize)), so it is slower
+ * than radix_sort_hybrid: it is meant for the inputs where the buffer doesn't fit. Equal bare
+ * keys can't be told apart, the overload with a payload below is the one where stability shows.
+ */
+template <size_t RADIX_BITS = 8, class T>
+void radix_sort_inplace_stable(T* a, size_t count, size_t scratchSize = INPLACE_STABLE_SCRATCH)
+{
+    scratchSize = std::max<size_t>(1, std::min(scratchSize, count));
+    if (count < 2) {
+        return;
+    }
+    if constexpr (is_counting_sortable<T>()) {
+        counting_sort(a, count, a);
+        return;
+    }
+    std::unique_ptr<T[]> scratch(new T[scratchSize]);
+
+    for (size_t lo = 0; lo < count; lo += scratchSize) {
+        const size_t n = std::min(scratchSize, count - lo);
+        const auto varying = varying_bits(a + lo, n);
+        if (varying != 0) {
+            details::radix_lsd<RADIX_BITS>(a + lo, scratch.get(), n, radix_digits<RADIX_BITS>::top_level(varying) + 1);
+        }
+    }
+
+    for (size_t width = scratchSize; width < count; width *= 2) {
+        for (size_t lo = 0; lo + width < count; lo += 2 * width) {
+            inplace_impl::merge_bounded(a + lo, a + lo + width, a + std::min(lo + 2 * width, count), scratch.get(), scratchSize);
+        }
+    }
+}
+
+/**
+ * radix_sort_inplace_stable of the keys a[0, count) with a payload: idx[0, count) is permuted
+ * along with the keys, so that the payloads of equal keys keep their original order. With idx
+ * filled with 0 ... count - 1 and a copy of the keys this is the stable argsort of
+ * radix_argsort_hybrid, in scratchSize keys and indices of scratch instead of 3n.
+ */
+template <size_t RADIX_BITS = 8, class T, class I>
+void radix_sort_inplace_stable(T* a, I* idx, size_t count, size_t scratchSize = INPLACE_STABLE_SCRATCH)
+{
+    details::check_digit_width<RADIX_BITS>();
+    scratchSize = std::max<size_t>(1, std::min(scratchSize, count));
+    if (count < 2) {
+        return;
+    }
+    std::unique_ptr<T[]> scratch(new T[scratchSize]);
+    std::unique_ptr<I[]> idxScratch(new I[scratchSize]);
+
+    for (size_t lo = 0; lo < count; lo += scratchSize) {
+        const size_t n = std::min(scratchSize, count - lo);
+        const auto varying = varying_bits(a + lo, n);
+        if (varying != 0) {
+            details::radix_lsd_indices<RADIX_BITS>(a + lo, idx + lo, scratch.get(), idxScratch.get(), n,
+                radix_digits<RADIX_BITS>::top_level(varying) + 1);
+        }
+    }
+
+    for (size_t width = scratchSize; width < count; width *= 2) {
+        for (size_t lo = 0; lo + width < count; lo += 2 * width) {
+            inplace_impl::merge_bounded_indices(a, idx, lo, lo + width, std::min(lo + 2 * width, count), scratch.get(), idxScratch.get(),
+                scratchSize);
+        }
+    }
+}
@@ -1,3 +1,5 @@
+#pragma once
+
 // Radix sort is taken from https://github.com/travisdowns/sort-bench
 /*
 MIT License
@@ -29,34 +31,34 @@ SOFTWARE.
 #include <memory>
 #include <stack>
 #include <string.h>
+#include <thread>
 #include <tuple>
+#include <vector>
 
 #include <x86intrin.h>
 
+#include "radix_counting_sort.h"
+#include "radix_digits.h"
+#include "radix_histogram.h"
+#include "radix_scatter.h"
+#include "work_stealing_pool.h"
+
 /* HEDLEY_INLINE */
 #define HEDLEY_INLINE inline
 /* HEDLEY_NEVER_INLINE */
 #define HEDLEY_NEVER_INLINE __attribute__((__noinline__))
 
-const size_t RADIX_BITS = 8;
-const size_t RADIX_SIZE = (size_t)1 << RADIX_BITS;
-const size_t RADIX_LEVELS = (63 / RADIX_BITS) + 1;
-
-using freq_array_type = size_t[RADIX_LEVELS][RADIX_SIZE];
+// the histograms of all the digits of the keys of T
+template <size_t RADIX_BITS, class T>
+using freq_array_type = size_t[radix_digits<RADIX_BITS>::template levels<T>()][radix_digits<RADIX_BITS>::RADIX_SIZE];
 
 // never inline just to make it show up easily in profiles (inlining this lengthly function doesn't
 // really help anyways)
-template <class T>
-HEDLEY_NEVER_INLINE static void count_frequency(T* a, size_t count, freq_array_type freqs)
+template <size_t RADIX_BITS, class T>
+HEDLEY_NEVER_INLINE static void count_frequency(T* a, size_t count, freq_array_type<RADIX_BITS, T>& freqs)
 {
-    constexpr T RADIX_MASK = RADIX_SIZE - 1;
-    for (size_t i = 0; i < count; i++) {
-        T value = a[i];
-        for (size_t pass = 0; pass < RADIX_LEVELS; pass++) {
-            freqs[pass][value & RADIX_MASK]++;
-            value >>= RADIX_BITS;
-        }
-    }
+    constexpr size_t RADIX_LEVELS = radix_digits<RADIX_BITS>::template levels<T>();
+    count_digits<RADIX_BITS, RADIX_LEVELS>(a, count, freqs, RADIX_LEVELS);
 }
 
 /**
@@ -66,7 +68,8 @@ HEDLEY_NEVER_INLINE static void count_frequency(T* a, size_t count, freq_array_t
  * occurrences. In that case, the radix step just acts as a copy so we can
  * skip it.
  */
-static bool is_trivial(size_t freqs[RADIX_SIZE], size_t count)
+template <size_t RADIX_SIZE>
+static bool is_trivial(const size_t (&freqs)[RADIX_SIZE], size_t count)
 {
     for (size_t i = 0; i < RADIX_SIZE; i++) {
         auto freq = freqs[i];
@@ -78,16 +81,24 @@ static bool is_trivial(size_t freqs[RADIX_SIZE], size_t count)
     return true;
 }
 
-template <class T>
-inline void radix_sort_lsd_travis(T* a, size_t count)
+// RADIX_BITS is the digit width (see radix_digits.h), MODE selects the scatter kernel (see radix_scatter.h)
+// queue_area is the scratch of radix_sort_scratch_size(count) elements
+template <size_t RADIX_BITS = 8, scatter_mode MODE = scatter_mode::direct, class T>
+inline void radix_sort_lsd_travis(T* a, size_t count, T* queue_area)
 {
-    constexpr T RADIX_MASK = RADIX_SIZE - 1;
-    std::unique_ptr<T[]> queue_area(new T[count]);
+    constexpr size_t RADIX_SIZE = radix_digits<RADIX_BITS>::RADIX_SIZE;
+    constexpr size_t RADIX_LEVELS = radix_digits<RADIX_BITS>::template levels<T>();
+    if constexpr (is_counting_sortable<T>()) {
+        counting_sort(a, count, a);
+        return;
+    }
 
-    freq_array_type freqs = {};
-    count_frequency(a, count, freqs);
+    // the histograms of the 16-bit digits would take 2MB of the stack
+    std::unique_ptr<freq_array_type<RADIX_BITS, T>[]> freqsArea(new freq_array_type<RADIX_BITS, T>[1]());
+    auto& freqs = freqsArea[0];
+    count_frequency<RADIX_BITS>(a, count, freqs);
 
-    T *from = a, *to = queue_area.get();
+    T *from = a, *to = queue_area;
 
     for (size_t pass = 0; pass < RADIX_LEVELS; pass++) {
 
@@ -96,7 +107,7 @@ inline void radix_sort_lsd_travis(T* a, size_t count)
             continue;
         }
 
-        T shift = pass * RADIX_BITS;
+        size_t shift = pass * RADIX_BITS;
 
         // array of pointers to the current position in each queue, which we set up based on the
         // known final sizes of each queue (i.e., "tighly packed")
@@ -108,13 +119,8 @@ inline void radix_sort_lsd_travis(T* a, size_t count)
 
         // copy each element into the appropriate queue based on the current RADIX_BITS sized
         // "digit" within it
-        for (size_t i = 0; i < count; i++) {
-            size_t value = from[i];
-            size_t index = (value >> shift) & RADIX_MASK;
-            *queue_ptrs[index]++ = value;
-            // I don't see that big impact
-            // __builtin_prefetch(queue_ptrs[index] + 1);
-        }
+        // I don't see that big impact of __builtin_prefetch(queue_ptrs[index] + 1)
+        radix_scatter<MODE, RADIX_SIZE>(from, count, queue_ptrs, [shift](T value) -> size_t { return radix_digit<RADIX_BITS>(value, shift); });
 
         // swap from and to areas
         std::swap(from, to);
@@ -126,3 +132,127 @@ inline void radix_sort_lsd_travis(T* a, size_t count)
         std::copy(from, from + count, a);
     }
 }
+
+template <size_t RADIX_BITS = 8, scatter_mode MODE = scatter_mode::direct, class T>
+inline void radix_sort_lsd_travis(T* a, size_t count)
+{
+    // not a std::vector, which would zero it first
+    std::unique_ptr<T[]> queue_area(new T[radix_sort_scratch_size<T>(count)]);
+    radix_sort_lsd_travis<RADIX_BITS, MODE>(a, count, queue_area.get());
+}
+
+// Runs fn(0) ... fn(pool.size() - 1) on the threads of the pool, the calling thread takes the
+// first slice. Returning from here acts as a barrier between the phases of the parallel sort.
+template <class Fn>
+void run_on_threads(work_stealing_pool& pool, Fn&& fn)
+{
+    task_group group;
+    for (size_t t = 1; t < pool.size(); t++) {
+        pool.submit(group, [&fn, t] { fn(t); });
+    }
+    fn(0);
+    pool.wait(group);
+}
+
+// minimal slice a thread is given, below that the threads and their barriers cost more than they save
+const size_t LSD_PARALLEL_MIN_SLICE = 1 << 16;
+
+/**
+ * Multi-threaded version of radix_sort_lsd_travis.
+ *
+ * The input is cut into numThreads contiguous slices. Each pass, every thread builds the
+ * histogram of its slice, the histograms are prefix-summed bucket by bucket across the threads
+ * and then every thread scatters its slice into its own disjoint ranges of the buckets. Since
+ * thread t writes after threads [0, t) in every bucket the sort stays stable. The threads are
+ * started once per sort, the phases are tasks of its pool.
+ */
+template <size_t RADIX_BITS = 8, class T>
+inline void radix_sort_lsd_parallel(T* a, size_t count, size_t numThreads = std::thread::hardware_concurrency())
+{
+    constexpr size_t RADIX_SIZE = radix_digits<RADIX_BITS>::RADIX_SIZE;
+    constexpr size_t RADIX_LEVELS = radix_digits<RADIX_BITS>::template levels<T>();
+    numThreads = std::max<size_t>(1, std::min(numThreads, count / LSD_PARALLEL_MIN_SLICE));
+    if (numThreads == 1 || is_counting_sortable<T>()) {
+        // the counting sort of the narrow keys is a read and a write pass, bound by the memory bandwidth
+        radix_sort_lsd_travis<RADIX_BITS>(a, count);
+        return;
+    }
+
+    std::unique_ptr<T[]> queue_area(new T[count]);
+    work_stealing_pool pool(numThreads);
+    auto sliceBegin = [count, numThreads](size_t t) { return count * t / numThreads; };
+
+    // per-thread histograms of all the digits, only used to find the trivial passes
+    // and as the histogram of the first non-trivial pass
+    std::unique_ptr<freq_array_type<RADIX_BITS, T>[]> threadFreqs(new freq_array_type<RADIX_BITS, T>[numThreads]);
+    run_on_threads(pool, [&](size_t t) {
+        memset(threadFreqs[t], 0, sizeof(freq_array_type<RADIX_BITS, T>));
+        count_frequency<RADIX_BITS>(a + sliceBegin(t), sliceBegin(t + 1) - sliceBegin(t), threadFreqs[t]);
+    });
+
+    std::unique_ptr<freq_array_type<RADIX_BITS, T>[]> freqsArea(new freq_array_type<RADIX_BITS, T>[1]());
+    auto& freqs = freqsArea[0];
+    for (size_t t = 0; t < numThreads; t++) {
+        for (size_t pass = 0; pass < RADIX_LEVELS; pass++) {
+            for (size_t i = 0; i < RADIX_SIZE; i++) {
+                freqs[pass][i] += threadFreqs[t][pass][i];
+            }
+        }
+    }
+
+    // threadCounts[t][i] is the number of elements of slice t going to bucket i, then the
+    // offset of the first of them in the output
+    std::unique_ptr<size_t[][RADIX_SIZE]> threadCounts(new size_t[numThreads][RADIX_SIZE]);
+    T *from = a, *to = queue_area.get();
+    bool firstPass = true;
+
+    for (size_t pass = 0; pass < RADIX_LEVELS; pass++) {
+
+        if (is_trivial(freqs[pass], count)) {
+            continue;
+        }
+
+        size_t shift = pass * RADIX_BITS;
+
+        if (firstPass) {
+            // nothing has been moved yet, so the initial histograms still describe the slices
+            for (size_t t = 0; t < numThreads; t++) {
+                std::copy(threadFreqs[t][pass], threadFreqs[t][pass] + RADIX_SIZE, threadCounts[t]);
+            }
+        } else {
+            run_on_threads(pool, [&](size_t t) {
+                count_digit<RADIX_BITS>(from + sliceBegin(t), sliceBegin(t + 1) - sliceBegin(t), shift, threadCounts[t]);
+            });
+        }
+        firstPass = false;
+
+        size_t next = 0;
+        for (size_t i = 0; i < RADIX_SIZE; i++) {
+            for (size_t t = 0; t < numThreads; t++) {
+                size_t c = threadCounts[t][i];
+                threadCounts[t][i] = next;
+                next += c;
+            }
+        }
+
+        run_on_threads(pool, [&](size_t t) {
+            T* queue_ptrs[RADIX_SIZE];
+            for (size_t i = 0; i < RADIX_SIZE; i++) {
+                queue_ptrs[i] = to + threadCounts[t][i];
+            }
+            for (size_t i = sliceBegin(t), e = sliceBegin(t + 1); i < e; i++) {
+                T value = from[i];
+                size_t index = radix_digit<RADIX_BITS>(value, shift);
+                *queue_ptrs[index]++ = value;
+            }
+        });
+
+        std::swap(from, to);
+    }
+
+    if (from != a) {
+        run_on_threads(pool, [&](size_t t) {
+            std::copy(from + sliceBegin(t), from + sliceBegin(t + 1), a + sliceBegin(t));
+        });
+    }
+}
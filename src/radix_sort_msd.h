@@ -1,16 +1,20 @@
+#pragma once
+
 #include <algorithm>
 #include <array>
 #include <assert.h>
 #include <memory>
 #include <string.h>
+#include <vector>
 
-namespace msd_impl {
-const size_t RADIX_BITS = 8;
-const size_t RADIX_SIZE = 1ull << RADIX_BITS;
-const size_t RADIX_LEVELS = (63ull / RADIX_BITS) + 1ull;
-const size_t DO_FINAL_SWAP = RADIX_LEVELS & 1ull; // if RADIX_LEVELS is even, buf contains the result
+#include "radix_counting_sort.h"
+#include "radix_digits.h"
+#include "radix_histogram.h"
+#include "radix_wide_keys.h"
 
-static bool is_trivial(size_t freqs[RADIX_SIZE], size_t count)
+namespace msd_impl {
+template <size_t RADIX_SIZE>
+static bool is_trivial(const size_t (&freqs)[RADIX_SIZE], size_t count)
 {
     for (size_t i = 0; i < RADIX_SIZE; i++) {
         auto freq = freqs[i];
@@ -21,23 +25,24 @@ static bool is_trivial(size_t freqs[RADIX_SIZE], size_t count)
     return true;
 }
 
-// pass <- [7, 0]
-template <class T>
-void radix_msd_rec(std::vector<T>& from, std::vector<T>& to, size_t lo, size_t hi, size_t pass)
+// Sorts from[lo, hi) by the digits [pass, 0], the result ends up in `to` if intoTo is set
+// and in `from` otherwise (see details::radix_msd_rec).
+// pass <- [RADIX_LEVELS - 1, 0]
+template <size_t RADIX_BITS, class T>
+void radix_msd_rec(T* from, T* to, size_t lo, size_t hi, size_t pass, bool intoTo)
 {
-    constexpr T RADIX_MASK = RADIX_SIZE - 1;
-    auto partFunc = [RADIX_MASK](T v, size_t i) -> T { return (v >> i) & RADIX_MASK; }; // inlined
+    constexpr size_t RADIX_SIZE = radix_digits<RADIX_BITS>::RADIX_SIZE;
+    auto partFunc = [](T v, size_t i) -> size_t { return radix_digit<RADIX_BITS>(v, i); }; // inlined
 
     size_t shift = pass * RADIX_BITS;
 
-    size_t freq[RADIX_SIZE] = {};
-    for (size_t i = lo; i < hi; ++i) {
-        T value = from[i];
-        ++freq[partFunc(value, shift)];
-    }
+    size_t freq[RADIX_SIZE];
+    count_digit<RADIX_BITS>(&from[0] + lo, hi - lo, shift, freq);
     if (is_trivial(freq, hi - lo)) {
         if (pass != 0) // at least one element to sort
-            radix_msd_rec(from, to, lo, hi, pass - 1);
+            radix_msd_rec<RADIX_BITS>(from, to, lo, hi, pass - 1, intoTo);
+        else if (intoTo)
+            std::copy(&from[0] + lo, &from[0] + hi, &to[0] + lo);
         return;
     }
 
@@ -54,24 +59,60 @@ void radix_msd_rec(std::vector<T>& from, std::vector<T>& to, size_t lo, size_t h
     }
 
     auto newLo = lo;
-    auto newHi = lo + freq[0];
-    for (size_t i = 1; i < RADIX_SIZE; ++i) {
+    for (size_t i = 0; i < RADIX_SIZE; ++i) {
+        auto newHi = newLo + freq[i];
         if (newHi - newLo > 1 && pass != 0) { // at least one element to sort
-            radix_msd_rec(to, from, newLo, newHi, pass - 1);
+            radix_msd_rec<RADIX_BITS>(to, from, newLo, newHi, pass - 1, !intoTo);
+        } else if (!intoTo) { // the bucket is final but sits in the scratch area
+            std::copy(&to[0] + newLo, &to[0] + newHi, &from[0] + newLo);
         }
         newLo = newHi;
-        newHi += freq[i];
     }
-    if (newHi - newLo > 1 && pass != 0)
-        radix_msd_rec(to, from, newLo, newHi, pass - 1);
 }
 }
 
-template <class T>
+// RADIX_BITS is the digit width, see radix_digits.h
+// scratch is radix_sort_scratch_size(count) elements, see radix_sort_hybrid(data, count, scratch)
+template <size_t RADIX_BITS = 8, class T>
+void radix_sort_msd(T* data, size_t count, T* scratch)
+{
+    static_assert(RADIX_BITS <= 12, "every level of the recursion keeps its histogram and queue pointers on the stack");
+    if constexpr (is_counting_sortable<T>()) {
+        counting_sort(data, count, data);
+        return;
+    }
+    if constexpr (is_wide_key<T>()) {
+        if (sort_low_words(data, count, [scratch] { return scratch; },
+                [](auto* words, size_t wordCount, auto* buffer) { radix_sort_msd<RADIX_BITS>(words, wordCount, buffer); })) {
+            return; // the high words don't take part in the order, see radix_wide_keys.h
+        }
+    }
+    const auto varying = varying_bits(data, count);
+    if (varying == 0) {
+        return; // all the keys are equal
+    }
+    msd_impl::radix_msd_rec<RADIX_BITS>(data, scratch, 0, count, radix_digits<RADIX_BITS>::top_level(varying), false);
+}
+
+template <size_t RADIX_BITS = 8, class T>
+void radix_sort_msd(T* data, size_t count)
+{
+    std::unique_ptr<T[]> scratch(new T[radix_sort_scratch_size<T>(count)]);
+    radix_sort_msd<RADIX_BITS>(data, count, scratch.get());
+}
+
+// std::vector front ends, scratch is grown to radix_sort_scratch_size if it is smaller
+template <size_t RADIX_BITS = 8, class T>
+void radix_sort_msd(std::vector<T>& data, std::vector<T>& scratch)
+{
+    if (scratch.size() < radix_sort_scratch_size<T>(data.size())) {
+        scratch.resize(radix_sort_scratch_size<T>(data.size()));
+    }
+    radix_sort_msd<RADIX_BITS>(data.data(), data.size(), scratch.data());
+}
+
+template <size_t RADIX_BITS = 8, class T>
 void radix_sort_msd(std::vector<T>& data)
 {
-    std::vector<T> buf(data.size());
-    msd_impl::radix_msd_rec(data, buf, 0, data.size(), msd_impl::RADIX_LEVELS - 1);
-    if (msd_impl::DO_FINAL_SWAP)
-        swap(data, buf);
+    radix_sort_msd<RADIX_BITS>(data.data(), data.size());
 }
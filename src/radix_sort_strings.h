@@ -0,0 +1,149 @@
+#pragma once
+
+#include <algorithm>
+#include <assert.h>
+#include <limits>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+#include <vector>
+
+#include "radix_sort_hybrid.h"
+
+// A string or binary column in the Arrow layout: the row i is the bytes data[offsets[i],
+// offsets[i + 1]), O is int32_t for utf8/binary and int64_t for large_utf8/large_binary.
+template <class O>
+struct string_column {
+    const O* offsets;
+    const uint8_t* data;
+};
+
+namespace strings_impl {
+// the bytes of a string in a key, the low byte of the key is the tag
+constexpr size_t CHUNK = 7;
+
+// The key of the bytes [depth, depth + CHUNK) of the row: the bytes big endian in the high 7 bytes
+// of the key, zero padded past the end of the string, and the number of them which are there,
+// min(length - depth, CHUNK), in the low byte. Two strings which agree on the bytes differ by the
+// tag if one of them ends there, the shorter one first, so the tag is the end-of-string bucket
+// and the keys compare as the strings do. A string goes on to the next chunk only with the tag
+// CHUNK.
+template <class O>
+uint64_t chunk_key(const string_column<O>& column, size_t row, size_t depth)
+{
+    const size_t begin = (size_t)column.offsets[row] + depth, end = (size_t)column.offsets[row + 1];
+    const size_t length = end - begin;
+    uint64_t key = 0;
+    if (length > CHUNK) {
+        memcpy(&key, column.data + begin, sizeof(key));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        key = __builtin_bswap64(key);
+#endif
+        return (key & ~(uint64_t)0xFF) | CHUNK;
+    }
+    for (size_t i = 0; i < length; ++i)
+        key |= (uint64_t)column.data[begin + i] << (56 - 8 * i);
+    return key | length;
+}
+
+// the order of the rows l and r by their bytes from depth on
+template <class O>
+bool suffix_less(const string_column<O>& column, size_t l, size_t r, size_t depth)
+{
+    const size_t lBegin = (size_t)column.offsets[l] + depth, lLength = (size_t)column.offsets[l + 1] - lBegin;
+    const size_t rBegin = (size_t)column.offsets[r] + depth, rLength = (size_t)column.offsets[r + 1] - rBegin;
+    const int cmp = memcmp(column.data + lBegin, column.data + rBegin, std::min(lLength, rLength));
+    return cmp != 0 ? cmp < 0 : lLength < rLength;
+}
+
+// the small ranges: stable, compares the suffixes in place instead of gathering chunks
+template <class O, class I>
+void insertion_sort_suffixes(const string_column<O>& column, I* idx, size_t count, size_t depth)
+{
+    for (size_t i = 1; i < count; ++i) {
+        const I index = idx[i];
+        size_t j = i;
+        for (; j > 0 && suffix_less(column, index, idx[j - 1], depth); --j)
+            idx[j] = idx[j - 1];
+        idx[j] = index;
+    }
+}
+
+// Sorts the rows idx[lo, hi), equal in their bytes [0, depth), by the bytes from depth on: gathers
+// their chunk at depth into keys[lo, hi), MSD sorts them as the integer keys, byte buckets down to
+// the LSD tails and the insertion sort of radix_msd_rec_indices, then goes on with the ranges of
+// equal chunks which don't end there. Depth first, as sort_columns_rec. A chunk which is the same
+// for the whole range, a shared prefix, costs a gather and no sort.
+template <size_t RADIX_BITS, class O, class I>
+void sort_strings_rec(const string_column<O>& column, uint64_t* keys, I* idx, argsort_scratch<uint64_t, I>& scratch,
+    size_t lo, size_t hi, size_t depth)
+{
+    uint64_t orAll, andAll;
+    for (;; depth += CHUNK) {
+        if (hi - lo < details::small_sort_threshold<RADIX_BITS>()) {
+            insertion_sort_suffixes(column, idx + lo, hi - lo, depth);
+            return;
+        }
+        orAll = 0;
+        andAll = ~(uint64_t)0;
+        for (size_t i = lo; i < hi; ++i) {
+            keys[i] = chunk_key(column, idx[i], depth);
+            orAll |= keys[i];
+            andAll &= keys[i];
+        }
+        if ((orAll ^ andAll) != 0)
+            break;
+        if ((andAll & 0xFF) != CHUNK)
+            return; // the strings are equal
+    }
+    details::radix_msd_rec_indices<RADIX_BITS>(keys, idx, scratch.keysBuf.data(), scratch.indicesBuf.data(), lo, hi,
+        radix_digits<RADIX_BITS>::top_level(orAll ^ andAll), false);
+
+    for (size_t runLo = lo; runLo < hi;) {
+        size_t runHi = runLo + 1;
+        while (runHi < hi && keys[runHi] == keys[runLo]) {
+            ++runHi;
+        }
+        if (runHi - runLo > 1 && (keys[runLo] & 0xFF) == CHUNK) {
+            sort_strings_rec<RADIX_BITS>(column, keys, idx, scratch, runLo, runHi, depth + CHUNK);
+        }
+        runLo = runHi;
+    }
+}
+}
+
+/**
+ * Stable argsort of a string or binary column by its bytes, memcmp order with a prefix before the
+ * longer strings: fills indices[0, count) with the permutation which sorts the rows, equal strings
+ * keep their original order. The strings aren't moved.
+ *
+ * An MSD radix sort by bytes which caches the prefix it works on: instead of reading a byte of
+ * every string per level, which costs a cache miss into data each, a level gathers the next 7
+ * bytes of the strings of a range into a 64-bit key once and sorts the keys and the indices by
+ * radix_msd_rec_indices, 7 byte levels for a pass over data. See strings_impl::chunk_key for the
+ * end of the strings.
+ */
+template <size_t RADIX_BITS = 8, class O, class I>
+void radix_argsort_strings(const string_column<O>& column, size_t count, I* indices, argsort_scratch<uint64_t, I>& scratch)
+{
+    details::check_digit_width<RADIX_BITS>();
+    static_assert(std::is_integral<O>::value && (sizeof(O) == 4 || sizeof(O) == 8), "O must be int32_t or int64_t");
+    static_assert(std::is_unsigned<I>::value && (sizeof(I) == 4 || sizeof(I) == 8), "I must be uint32_t or uint64_t");
+    assert(count <= (size_t)std::numeric_limits<I>::max());
+
+    for (size_t i = 0; i < count; ++i)
+        indices[i] = (I)i;
+    scratch.reserve(count);
+
+    if (count > 1)
+        strings_impl::sort_strings_rec<RADIX_BITS>(column, scratch.keys.data(), indices, scratch, 0, count, 0);
+}
+
+template <size_t RADIX_BITS = 8, class O, class I = uint32_t>
+void radix_argsort_strings(const std::vector<O>& offsets, const std::vector<uint8_t>& data, std::vector<I>& indices)
+{
+    assert(!offsets.empty());
+    argsort_scratch<uint64_t, I> scratch;
+    indices.resize(offsets.size() - 1);
+    radix_argsort_strings<RADIX_BITS>(string_column<O> { offsets.data(), data.data() }, indices.size(), indices.data(), scratch);
+}
@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "radix_sort_hybrid.h"
+#include "radix_tuning.h"
+#include "sort_registry.h"
+
+/**
+ * Calibrates the parameters of radix_tuning.h on this machine and writes them as a profile:
+ *
+ *     radix_tune [profile path, radix_tuning.conf by default] [--quick]
+ *
+ * radix_sort_hybrid_tuned sorts the distributions of allunique_bmk at sizes from the L2 to far
+ * beyond the L3. Every digit width sweeps the LSD threshold and then the small sort threshold at
+ * the best LSD threshold, one at a time. The score of a profile is the geometric mean of its times
+ * relative to the defaults derived from the cache sizes, the best one is written, the defaults
+ * unless something beats them by more than the noise.
+ */
+
+using T = uint64_t;
+
+namespace {
+struct tune_case {
+    std::string name;
+    std::vector<T> input;
+};
+
+struct tuner {
+    std::vector<tune_case> cases;
+    radix_tuning baseline;
+    std::vector<T> values, scratch;
+
+    // seconds of sorting the case c with the current profile
+    double time_sort(const tune_case& c)
+    {
+        std::copy(c.input.begin(), c.input.end(), values.begin());
+        const auto start = std::chrono::steady_clock::now();
+        radix_sort_hybrid_tuned(values.data(), c.input.size(), scratch.data());
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count();
+    }
+
+    // Geometric mean of the times of tuning relative to the baseline over the cases, lower is
+    // better. The two alternate on every repetition, so the drift of the machine hits both alike.
+    double score(const radix_tuning& tuning)
+    {
+        double logSum = 0;
+        for (const auto& c : cases) {
+            const size_t reps = std::min<size_t>(50, std::max<size_t>(5, ((size_t)1 << 24) / c.input.size()));
+            double bestBaseline = INFINITY, best = INFINITY;
+            for (size_t r = 0; r < reps; ++r) {
+                set_radix_tuning_profile(baseline);
+                bestBaseline = std::min(bestBaseline, time_sort(c));
+                set_radix_tuning_profile(tuning);
+                best = std::min(best, time_sort(c));
+            }
+            logSum += std::log(best / bestBaseline);
+        }
+        const double result = std::exp(logSum / cases.size());
+        std::cout << "radix_bits " << tuning.radixBits << " lsd_threshold " << tuning.lsdThreshold
+                  << " small_sort_threshold " << tuning.smallSortThreshold << ": " << result << std::endl;
+        return result;
+    }
+};
+}
+
+int main(int argc, char** argv)
+{
+    std::string path = "radix_tuning.conf";
+    bool quick = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--quick")
+            quick = true;
+        else
+            path = arg;
+    }
+
+    const std::vector<sort_registry::distribution<T>> dists = {
+        sort_registry::distributions::all_unique<T>(),
+        sort_registry::distributions::uniform_up_to<T>("uniform_1B", 1000000000),
+        sort_registry::distributions::uniform_up_to<T>("uniform_48bit", ((T)1 << 48) - 1),
+    };
+    const std::vector<size_t> sizes = quick ? std::vector<size_t> { 1 << 16, 1 << 20 } : std::vector<size_t> { 1 << 16, 1 << 20, 1 << 23 };
+
+    tuner t;
+    for (const auto& dist : dists) {
+        for (size_t n : sizes) {
+            tune_case c { dist.name + "/" + std::to_string(n), std::vector<T>(n) };
+            dist.generate(c.input, n);
+            t.cases.push_back(std::move(c));
+        }
+    }
+    t.values.resize(sizes.back());
+    t.scratch.resize(radix_sort_scratch_size<T>(sizes.back()));
+
+    const radix_tuning defaults = tuning_impl::from_cache_sizes();
+    t.baseline = defaults;
+
+    // the repetitions of the same profile differ by a few percent, less is noise
+    const double minGain = 0.02;
+    radix_tuning best = defaults;
+    double bestScore = 1 - minGain;
+    for (size_t bits : { 8, 11 }) {
+        radix_tuning tuning = defaults;
+        tuning.radixBits = bits;
+        double score = INFINITY;
+        for (size_t lsd = 1 << 10; lsd <= (1 << 18); lsd *= 2) {
+            radix_tuning candidate = tuning;
+            candidate.lsdThreshold = lsd;
+            const double s = t.score(candidate);
+            if (s < score) {
+                score = s;
+                tuning = candidate;
+            }
+        }
+        for (size_t small : { 8, 16, 32, 64, 128 }) {
+            radix_tuning candidate = tuning;
+            candidate.smallSortThreshold = small;
+            const double s = t.score(candidate);
+            if (s < score) {
+                score = s;
+                tuning = candidate;
+            }
+        }
+        if (score < bestScore) {
+            bestScore = score;
+            best = tuning;
+        }
+    }
+
+    std::ofstream out(path);
+    out << "# radix_tune: " << std::min(bestScore, 1.0) << " of the time of the defaults, L2 " << tuning_impl::cache_size(2)
+        << " bytes, L3 " << tuning_impl::cache_size(3) << " bytes\n";
+    tuning_impl::write_profile(out, best);
+    if (!out) {
+        std::cerr << "can't write " << path << std::endl;
+        return 1;
+    }
+    std::cout << "\n" << path << ":\n";
+    tuning_impl::write_profile(std::cout, best);
+    return 0;
+}
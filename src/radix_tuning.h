@@ -0,0 +1,150 @@
+#pragma once
+
+#include <algorithm>
+#include <fstream>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string>
+
+/**
+ * The machine dependent parameters of the hybrid sort, which the README tuned on one laptop: the
+ * range below which the MSD recursion hands over to the LSD passes, the bucket below which
+ * std::stable_sort takes over, and the digit width of radix_sort_hybrid_tuned.
+ *
+ * radix_tuning_profile() is set up once, on the first sort:
+ *  - the values baked in at compile time, the RADIX_TUNING_* definitions which the CMake option
+ *    RADIX_TUNING_PROFILE derives from a profile file, or else
+ *  - the profile file named by the environment variable RADIX_TUNING_PROFILE, or else
+ *  - the defaults derived from the cache sizes of sysfs, see tuning_impl::from_cache_sizes.
+ *
+ * The profile files are written by radix_tune, which sweeps the parameters over the benchmark
+ * distributions: `key = value` lines, `#` starts a comment, the keys left out keep their default.
+ */
+struct radix_tuning {
+    // keys, the LSD passes over a range and its scratch stay in L2 below it
+    size_t lsdThreshold = 1 << 14;
+    // keys, the minimum, the wider digits raise it, see details::small_sort_threshold
+    size_t smallSortThreshold = 16;
+    // 8 or 11
+    size_t radixBits = 8;
+};
+
+namespace tuning_impl {
+// "48K", "2048K" or "32M" in bytes
+inline size_t parse_cache_size(const std::string& text)
+{
+    size_t pos = 0;
+    size_t size = std::stoul(text, &pos);
+    if (pos < text.size() && text[pos] == 'K')
+        size <<= 10;
+    else if (pos < text.size() && text[pos] == 'M')
+        size <<= 20;
+    return size;
+}
+
+// the size in bytes of the data or unified cache of `level` of cpu0, 0 when sysfs doesn't say
+inline size_t cache_size(int level)
+{
+    for (int index = 0; index < 16; ++index) {
+        const std::string dir = "/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(index) + "/";
+        std::ifstream levelFile(dir + "level"), typeFile(dir + "type"), sizeFile(dir + "size");
+        int cacheLevel = 0;
+        std::string type, size;
+        if (!(levelFile >> cacheLevel) || !(typeFile >> type) || !(sizeFile >> size))
+            break;
+        if (cacheLevel == level && type != "Instruction")
+            return parse_cache_size(size);
+    }
+    return 0;
+}
+
+// The LSD tail of a range of 64-bit keys touches 16 bytes per key with its scratch: the README's
+// 16K keys on a 256K L2. The threshold is the largest power of two which keeps them in L2.
+inline radix_tuning from_cache_sizes()
+{
+    radix_tuning tuning;
+    const size_t l2 = cache_size(2);
+    if (l2 != 0) {
+        const size_t keys = l2 / 16;
+        size_t threshold = 1;
+        while (threshold * 2 <= keys)
+            threshold *= 2;
+        tuning.lsdThreshold = std::min<size_t>(std::max<size_t>(threshold, 1 << 12), 1 << 18);
+    }
+    return tuning;
+}
+
+// Reads the `key = value` lines of path over tuning, false if the file can't be read or has a line
+// which isn't one of the keys of radix_tuning.
+inline bool load_profile(const std::string& path, radix_tuning& tuning)
+{
+    std::ifstream in(path);
+    if (!in)
+        return false;
+    std::string line;
+    while (std::getline(in, line)) {
+        line = line.substr(0, line.find('#'));
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+            continue;
+        const size_t eq = line.find('=');
+        if (eq == std::string::npos)
+            return false;
+        std::string key = line.substr(0, eq);
+        key.erase(key.find_last_not_of(" \t") + 1);
+        key.erase(0, key.find_first_not_of(" \t"));
+        const char* value = line.c_str() + eq + 1;
+        char* end;
+        const size_t number = strtoul(value, &end, 10);
+        if (end == value)
+            return false;
+        if (key == "lsd_threshold")
+            tuning.lsdThreshold = std::max<size_t>(number, 1);
+        else if (key == "small_sort_threshold")
+            tuning.smallSortThreshold = std::max<size_t>(number, 2);
+        else if (key == "radix_bits")
+            tuning.radixBits = number == 11 ? 11 : 8;
+        else
+            return false;
+    }
+    return true;
+}
+
+inline void write_profile(std::ostream& out, const radix_tuning& tuning)
+{
+    out << "lsd_threshold = " << tuning.lsdThreshold << "\n"
+        << "small_sort_threshold = " << tuning.smallSortThreshold << "\n"
+        << "radix_bits = " << tuning.radixBits << "\n";
+}
+
+inline radix_tuning initial_profile()
+{
+    radix_tuning tuning = from_cache_sizes();
+#if defined(RADIX_TUNING_LSD_THRESHOLD) || defined(RADIX_TUNING_SMALL_SORT_THRESHOLD) || defined(RADIX_TUNING_RADIX_BITS)
+#ifdef RADIX_TUNING_LSD_THRESHOLD
+    tuning.lsdThreshold = RADIX_TUNING_LSD_THRESHOLD;
+#endif
+#ifdef RADIX_TUNING_SMALL_SORT_THRESHOLD
+    tuning.smallSortThreshold = RADIX_TUNING_SMALL_SORT_THRESHOLD;
+#endif
+#ifdef RADIX_TUNING_RADIX_BITS
+    tuning.radixBits = RADIX_TUNING_RADIX_BITS;
+#endif
+#else
+    const char* path = getenv("RADIX_TUNING_PROFILE");
+    if (path != nullptr && !load_profile(path, tuning))
+        tuning = from_cache_sizes(); // a broken profile doesn't half apply
+#endif
+    return tuning;
+}
+
+inline radix_tuning& profile()
+{
+    static radix_tuning tuning = initial_profile();
+    return tuning;
+}
+}
+
+inline const radix_tuning& radix_tuning_profile() { return tuning_impl::profile(); }
+
+// Replaces the profile, for radix_tune and the tests: not while a sort runs on another thread.
+inline void set_radix_tuning_profile(const radix_tuning& tuning) { tuning_impl::profile() = tuning; }
@@ -0,0 +1,260 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "radix_counting_sort.h"
+#include "radix_digits.h"
+#include "radix_histogram.h"
+#include "radix_presorted.h"
+#include "radix_sort_hybrid.h"
+#include "radix_sort_msd.h"
+
+/**
+ * DISTINCT and GROUP BY key COUNT(*) by the MSD radix sort without materializing the sorted keys:
+ * radix_sort_count emits the runs of equal keys in ascending order, a key and the number of its
+ * copies each, radix_sort_unique only the keys.
+ *
+ * The recursion is the one of radix_sort_msd, except for what happens once the bits left of a
+ * bucket are all equal. The last digit isn't scattered at all: its histogram is the runs, the key
+ * of every digit value is the prefix of the bucket and the digit. A bucket which holds a single
+ * key after a scatter, the few unique values of a column, is found by a scan which stops at the
+ * first other key and becomes a run right away instead of being counted again on every digit
+ * below. Either way a run costs O(1) writes, not a write per copy.
+ *
+ * The sorted and the descending inputs are counted by a single pass over them, the other nearly
+ * sorted ones are sorted by the fast paths of radix_presorted.h first.
+ *
+ * The keys are equal when their radix_key are, so -0.0 and 0.0 are two runs as they are two
+ * places in the sort order.
+ */
+namespace unique_impl {
+// the runs go to keys and counts, counts may be null
+template <class T>
+struct run_writer {
+    T* keys;
+    size_t* counts;
+    size_t runs = 0;
+
+    void emit(T key, size_t count)
+    {
+        keys[runs] = key;
+        if (counts != nullptr)
+            counts[runs] = count;
+        ++runs;
+    }
+};
+
+// true if all of a[0, count) have the key of a[0], stops at the first block with another one: a
+// branch per element wouldn't vectorize
+template <class T>
+bool all_equal(const T* a, size_t count)
+{
+    const size_t BLOCK = 64;
+    const auto key = radix_key(a[0]);
+    for (size_t lo = 0; lo < count; lo += BLOCK) {
+        const size_t hi = std::min(count, lo + BLOCK);
+        radix_key_t<T> diff = 0;
+        for (size_t i = lo; i < hi; ++i)
+            diff |= radix_key(a[i]) ^ key;
+        if (diff != 0)
+            return false;
+    }
+    return true;
+}
+
+// emits the runs of the sorted a[0, count) in a single pass
+template <class T>
+void emit_runs(const T* a, size_t count, run_writer<T>& out)
+{
+    for (size_t i = 0; i < count;) {
+        size_t j = i + 1;
+        while (j < count && radix_key(a[j]) == radix_key(a[i]))
+            ++j;
+        out.emit(a[i], j - i);
+        i = j;
+    }
+}
+
+// emits the runs of the descending a[0, count), from its end
+template <class T>
+void emit_runs_reversed(const T* a, size_t count, run_writer<T>& out)
+{
+    for (size_t i = count; i != 0;) {
+        size_t j = i - 1;
+        while (j != 0 && radix_key(a[j - 1]) == radix_key(a[i - 1]))
+            --j;
+        out.emit(a[i - 1], i - j);
+        i = j;
+    }
+}
+
+// Emits the runs of from[0, count) whose digits above `pass` are all equal, by the digits
+// [pass, 0]. from is read once by the histograms and the scatter into to[0, count), the buckets
+// below alternate between to and other.
+template <size_t RADIX_BITS, class T>
+void count_runs_rec(const T* from, T* to, T* other, size_t count, size_t pass, run_writer<T>& out)
+{
+    using K = radix_key_t<T>;
+    constexpr size_t RADIX_SIZE = radix_digits<RADIX_BITS>::RADIX_SIZE;
+    constexpr K RADIX_MASK = RADIX_SIZE - 1;
+
+    if (count < details::small_sort_threshold<RADIX_BITS>()) {
+        std::copy(from, from + count, to);
+        std::sort(to, to + count, radix_less());
+        emit_runs(to, count, out);
+        return;
+    }
+    size_t freq[RADIX_SIZE];
+    for (;; --pass) {
+        const size_t shift = pass * RADIX_BITS;
+        count_digit<RADIX_BITS>(from, count, shift, freq);
+        if (pass == 0) {
+            // the histogram of the last digit is the runs
+            const K prefix = radix_key(from[0]) & ~RADIX_MASK;
+            for (size_t i = 0; i < RADIX_SIZE; ++i) {
+                if (freq[i] != 0)
+                    out.emit(radix_key_traits<T>::value((K)(prefix | i)), freq[i]);
+            }
+            return;
+        }
+        if (!msd_impl::is_trivial(freq, count))
+            break;
+    }
+
+    const size_t shift = pass * RADIX_BITS;
+    T* queue_ptrs[RADIX_SIZE];
+    queue_ptrs[0] = to;
+    for (size_t i = 1; i < RADIX_SIZE; ++i)
+        queue_ptrs[i] = queue_ptrs[i - 1] + freq[i - 1];
+    for (size_t i = 0; i < count; ++i) {
+        const T value = from[i];
+        *queue_ptrs[radix_digit<RADIX_BITS>(value, shift)]++ = value;
+    }
+
+    size_t lo = 0;
+    for (size_t i = 0; i < RADIX_SIZE; ++i) {
+        const size_t n = freq[i];
+        if (n == 0)
+            continue;
+        if (all_equal(to + lo, n))
+            out.emit(to[lo], n);
+        else
+            count_runs_rec<RADIX_BITS>(to + lo, other + lo, to + lo, n, pass - 1, out);
+        lo += n;
+    }
+}
+
+// the runs of the 8- and 16-bit keys from a histogram of all their values
+template <class Counter, class T>
+void count_runs_wide(const T* data, size_t count, run_writer<T>& out)
+{
+    using K = radix_key_t<T>;
+    constexpr size_t SIZE = (size_t)1 << (sizeof(T) * 8);
+    std::unique_ptr<Counter[]> freq(new Counter[SIZE]());
+    for (size_t i = 0; i < count; i++) {
+        freq[radix_key(data[i])]++;
+    }
+    for (size_t k = 0; k < SIZE; k++) {
+        if (freq[k] != 0)
+            out.emit(radix_key_traits<T>::value((K)k), freq[k]);
+    }
+}
+}
+
+// the scratch of radix_sort_count(data, count, ...): the recursion alternates between two buffers
+// as data is left alone
+template <class T>
+constexpr size_t radix_unique_scratch_size(size_t count) { return 2 * radix_sort_scratch_size<T>(count); }
+
+/**
+ * Writes the distinct keys of data[0, count) in ascending order to keys and the number of copies
+ * of each to counts, unless counts is null, and returns the number of distinct keys. keys and
+ * counts have room for count elements, the number of distinct keys at most. scratch is
+ * radix_unique_scratch_size(count) elements, data isn't modified.
+ */
+template <size_t RADIX_BITS = 8, class T>
+size_t radix_sort_count(const T* data, size_t count, T* keys, size_t* counts, T* scratch)
+{
+    details::check_digit_width<RADIX_BITS>();
+    unique_impl::run_writer<T> out { keys, counts };
+    if (count == 0)
+        return 0;
+    if constexpr (is_counting_sortable<T>()) {
+        if (count >= ((size_t)1 << (sizeof(T) * 8)) / 8) {
+            if (count <= UINT32_MAX)
+                unique_impl::count_runs_wide<uint32_t>(data, count, out);
+            else
+                unique_impl::count_runs_wide<size_t>(data, count, out);
+            return out.runs;
+        }
+    }
+    if (unique_impl::all_equal(data, count)) {
+        out.emit(data[0], count); // stops at the first other key otherwise
+        return out.runs;
+    }
+    const auto scan = scan_keys(data, 0, count);
+    if (scan.descents == 0) {
+        unique_impl::emit_runs(data, count, out);
+        return out.runs;
+    }
+    if (scan.ascents == 0) {
+        unique_impl::emit_runs_reversed(data, count, out);
+        return out.runs;
+    }
+    T* first = scratch;
+    T* second = scratch + radix_sort_scratch_size<T>(count);
+    if (is_presorted(scan, count)) {
+        // a few runs or outliers: sorted by the fast paths of the hybrid sort, then counted
+        std::copy(data, data + count, first);
+        if (sort_presorted(first, count, scan, [second] { return second; },
+                [second](T* side, size_t sideCount) { radix_sort_hybrid<RADIX_BITS>(side, sideCount, second); })) {
+            unique_impl::emit_runs(first, count, out);
+            return out.runs;
+        }
+    }
+    // the first level reads data, the ones below take turns in the halves of scratch
+    unique_impl::count_runs_rec<RADIX_BITS>(data, first, second, count, radix_digits<RADIX_BITS>::top_level(scan.varying()), out);
+    return out.runs;
+}
+
+template <size_t RADIX_BITS = 8, class T>
+size_t radix_sort_count(const T* data, size_t count, T* keys, size_t* counts)
+{
+    std::unique_ptr<T[]> scratch(new T[radix_unique_scratch_size<T>(count)]);
+    return radix_sort_count<RADIX_BITS>(data, count, keys, counts, scratch.get());
+}
+
+// The distinct keys of data[0, count) in ascending order, see radix_sort_count.
+template <size_t RADIX_BITS = 8, class T>
+size_t radix_sort_unique(const T* data, size_t count, T* keys, T* scratch)
+{
+    return radix_sort_count<RADIX_BITS>(data, count, keys, nullptr, scratch);
+}
+
+template <size_t RADIX_BITS = 8, class T>
+size_t radix_sort_unique(const T* data, size_t count, T* keys)
+{
+    return radix_sort_count<RADIX_BITS>(data, count, keys, nullptr);
+}
+
+// std::vector front ends, keys and counts are resized to the number of distinct keys
+template <size_t RADIX_BITS = 8, class T>
+void radix_sort_count(const std::vector<T>& data, std::vector<T>& keys, std::vector<size_t>& counts)
+{
+    keys.resize(data.size());
+    counts.resize(data.size());
+    const size_t runs = radix_sort_count<RADIX_BITS>(data.data(), data.size(), keys.data(), counts.data());
+    keys.resize(runs);
+    counts.resize(runs);
+}
+
+template <size_t RADIX_BITS = 8, class T>
+void radix_sort_unique(const std::vector<T>& data, std::vector<T>& keys)
+{
+    keys.resize(data.size());
+    keys.resize(radix_sort_unique<RADIX_BITS>(data.data(), data.size(), keys.data()));
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <algorithm>
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+#include "radix_key.h"
+
+/**
+ * The 128-bit keys of radix_key.h go through the same MSD recursion as the others, with 16 digits
+ * of 8 bits instead of 8 and twice the bytes per scatter. Most decimal128 columns don't need the
+ * high word though: prices and amounts fit into 64 bits, so their high word is the sign extension
+ * of the low one, and the hashes of a partition or the decimals of a small range share it. Such
+ * keys are ordered by their low words alone, as int64_t for the sign extended decimals and as
+ * uint64_t under a common high word, and are sorted as 64-bit keys: half the bytes per pass.
+ */
+namespace wide_impl {
+// one scan over the high words, stops at the first block of BLOCK keys which rules both out
+struct high_words {
+    bool constant = true; // all equal to the one of the first key
+    bool signExtended = true; // all the sign extension of their low word
+};
+
+template <class T>
+high_words scan_high_words(const T* data, size_t count)
+{
+    const size_t BLOCK = 64;
+    constexpr bool SIGNED = std::is_signed<decltype(T::hi)>::value;
+    high_words scan;
+    scan.signExtended = SIGNED;
+    const uint64_t first = (uint64_t)data[0].hi;
+    for (size_t lo = 0; lo < count && (scan.constant || scan.signExtended); lo += BLOCK) {
+        const size_t hi = std::min(count, lo + BLOCK);
+        uint64_t constantDiff = 0, signDiff = 0;
+        for (size_t i = lo; i < hi; ++i) {
+            constantDiff |= (uint64_t)data[i].hi ^ first;
+            signDiff |= (uint64_t)data[i].hi ^ (uint64_t)((int64_t)data[i].lo >> 63);
+        }
+        scan.constant &= constantDiff == 0;
+        scan.signExtended &= signDiff == 0;
+    }
+    return scan;
+}
+}
+
+/**
+ * Sorts data[0, count) of 128-bit keys by their low words if the high words allow it, see above,
+ * and returns false otherwise. The low words are sorted in the scratch, radix_sort_scratch_size
+ * (count) keys of T, which are 2 * count words: sort64(words, count, buffer) sorts the first count
+ * of them with the others as its buffer, called with uint64_t* or int64_t*.
+ */
+template <class T, class GetScratch, class Sort64>
+bool sort_low_words(T* data, size_t count, GetScratch getScratch, Sort64 sort64)
+{
+    static_assert(is_wide_key<T>(), "only the 128-bit keys have a high word");
+    if (count < 2)
+        return true;
+    const auto scan = wide_impl::scan_high_words(data, count);
+    if (!scan.constant && !scan.signExtended)
+        return false;
+
+    // the scratch holds keys of two words, nothing else reads it as keys meanwhile
+    uint64_t* words = reinterpret_cast<uint64_t*>(getScratch());
+    for (size_t i = 0; i < count; ++i)
+        words[i] = data[i].lo;
+    using high_type = decltype(T::hi);
+    if (scan.constant) {
+        // the sign extension of all non negative or all negative keys too
+        const high_type high = data[0].hi;
+        sort64(words, count, words + count);
+        for (size_t i = 0; i < count; ++i)
+            data[i] = { words[i], high };
+    } else {
+        int64_t* values = reinterpret_cast<int64_t*>(words);
+        sort64(values, count, values + count);
+        for (size_t i = 0; i < count; ++i)
+            data[i] = { (uint64_t)values[i], (high_type)(values[i] >> 63) };
+    }
+    return true;
+}
@@ -0,0 +1,508 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <boost/sort/spreadsort/spreadsort.hpp>
+#include <cmath>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "perf_counters.h"
+#include "radix_select.h"
+#include "radix_sort.h"
+#include "radix_sort_hybrid.h"
+#include "radix_sort_inplace.h"
+#include "radix_sort_lsd.h"
+#include "radix_sort_msd.h"
+#include "radix_unique.h"
+
+/**
+ * The sort benchmarks as the cross product of the algorithms, the distributions of the keys, the
+ * sizes and the key types: register_sorts names every combination
+ * SortingBmk_<distribution>[_<key type>]/<algorithm>/<size>, the key type is left out for uint64_t,
+ * and reports the time, items_per_second, bytes_per_second, peak_mem and the hardware counters
+ * of perf_counters.h. A new sort variant is one more entry of sort_algorithms below, a new
+ * distribution one more of distributions, and both get benchmarked against everything else.
+ *
+ * The input is generated once per benchmark run, the timed loop copies it and sorts the copy,
+ * as the sorts of a column which has to be kept would.
+ */
+namespace sort_registry {
+
+// The buffers of sort_context: an algorithm names the ones it uses, run() allocates only those,
+// so that the large sweeps don't hold the buffers of the argsorts and the counts for every sort.
+namespace buffers {
+    constexpr unsigned values = 1;
+    constexpr unsigned scratch = 2; // radix_sort_scratch_size
+    constexpr unsigned unique_scratch = 4; // radix_unique_scratch_size, implies scratch
+    constexpr unsigned indices = 8;
+    constexpr unsigned counts = 16;
+}
+
+// What an algorithm may keep between the iterations of its benchmark, the buffers it doesn't use
+// are empty.
+template <class T>
+struct sort_context {
+    size_t threads = 1;
+    std::vector<T> values; // the sorted copy of the input, count elements
+    // radix_sort_scratch_size(count) for the sorts which take their buffer, radix_unique_scratch_size
+    // for radix_sort_count
+    std::vector<T> scratch;
+    std::vector<uint32_t> indices; // the output of the argsorts, count elements
+    std::vector<size_t> counts; // the run lengths of the group counts, count elements
+};
+
+template <class T>
+struct algorithm {
+    std::string name;
+    std::function<void(const T* input, size_t count, sort_context<T>& context)> run;
+    bool parallel = false; // swept over the threads, see register_sorts
+    unsigned uses = 0; // the buffers of the context, see buffers
+
+    algorithm with(unsigned more) const
+    {
+        algorithm copy = *this;
+        copy.uses |= more;
+        return copy;
+    }
+};
+
+template <class T>
+struct distribution {
+    std::string name;
+    std::function<void(std::vector<T>& vals, size_t count)> generate;
+};
+
+// an algorithm which sorts in place: the timed loop copies the input into context.values first
+template <class T, class Fn>
+algorithm<T> in_place(const std::string& name, Fn sort, bool parallel = false)
+{
+    return { name, [sort](const T* input, size_t count, sort_context<T>& context) {
+                std::copy(input, input + count, context.values.begin());
+                sort(context.values.data(), count, context);
+            },
+        parallel, buffers::values };
+}
+
+template <class T>
+std::string key_type_name()
+{
+    const std::string bits = std::to_string(sizeof(T) * 8);
+    if constexpr (std::is_same<T, decimal128>::value)
+        return "decimal128";
+    else if constexpr (std::is_floating_point<T>::value)
+        return sizeof(T) == 4 ? "float" : "double";
+    else if constexpr (std::is_signed<T>::value)
+        return "int" + bits;
+    else
+        return "uint" + bits;
+}
+
+/**
+ * All the sorts of the repo. The argsorts and the scratch allocation aren't sorts, the former
+ * write context.indices, the latter is what the sorts which allocate their buffer pay for it.
+ */
+template <class T>
+std::vector<algorithm<T>> sort_algorithms()
+{
+    using ctx = sort_context<T>;
+    return {
+        // We are interested in stable sort because it is currently used
+        in_place<T>("StdStableSort", [](T* a, size_t n, ctx&) { std::stable_sort(a, a + n); }),
+        in_place<T>("BoostSpreadSort", [](T* a, size_t n, ctx&) { boost::sort::spreadsort::spreadsort(a, a + n); }),
+        in_place<T>("MSDRadixSort", [](T* a, size_t n, ctx&) { radix_sort_msd(a, n); }),
+        in_place<T>("LSDRadixSort", [](T* a, size_t n, ctx&) { radix_sort_lsd_travis(a, n); }),
+        in_place<T>("HybridRadixSort", [](T* a, size_t n, ctx&) { radix_sort_hybrid(a, n); }),
+        // the front door, sampled and routed to the sorts above, see radix_sort.h
+        in_place<T>("RadixSort", [](T* a, size_t n, ctx& c) { radix_sort(a, n, c.scratch.data()); }).with(buffers::scratch),
+
+        // Digit widths, see radix_digits.h
+        in_place<T>("LSDRadixSort11", [](T* a, size_t n, ctx&) { radix_sort_lsd_travis<11>(a, n); }),
+        in_place<T>("LSDRadixSort16", [](T* a, size_t n, ctx&) { radix_sort_lsd_travis<16>(a, n); }),
+        in_place<T>("MSDRadixSort11", [](T* a, size_t n, ctx&) { radix_sort_msd<11>(a, n); }),
+        in_place<T>("HybridRadixSort11", [](T* a, size_t n, ctx&) { radix_sort_hybrid<11>(a, n); }),
+        // the digit width and the thresholds of the tuning profile, see radix_tuning.h
+        in_place<T>("HybridRadixSortTuned", [](T* a, size_t n, ctx&) { radix_sort_hybrid_tuned(a, n); }),
+
+        // Reused scratch: the difference to the sorts above is what allocating their buffer costs
+        in_place<T>("HybridRadixSortScratch", [](T* a, size_t n, ctx& c) { radix_sort_hybrid(a, n, c.scratch.data()); }).with(buffers::scratch),
+        in_place<T>("MSDRadixSortScratch", [](T* a, size_t n, ctx& c) { radix_sort_msd(a, n, c.scratch.data()); }).with(buffers::scratch),
+        in_place<T>("LSDRadixSortScratch", [](T* a, size_t n, ctx& c) { radix_sort_lsd_travis(a, n, c.scratch.data()); }).with(buffers::scratch),
+        // the allocation alone: a fresh zeroed buffer as the sorts above get it
+        { "ScratchAllocation", [](const T*, size_t n, ctx&) {
+             std::vector<T> buf(n);
+             benchmark::DoNotOptimize(buf);
+         } },
+        // Out-of-place from the input: the copy of the sorts above is folded into the first scatter
+        { "HybridRadixSortCopy", [](const T* input, size_t n, ctx& c) { radix_sort_hybrid_copy(input, n, c.values.data(), c.scratch.data()); },
+            false, buffers::values | buffers::scratch },
+
+        // Scatter kernels, see radix_scatter.h, they only differ on the inputs larger than the caches
+        in_place<T>("LSDRadixSortBuffered", [](T* a, size_t n, ctx&) { radix_sort_lsd_travis<8, scatter_mode::buffered>(a, n); }),
+        in_place<T>("HybridRadixSortBuffered", [](T* a, size_t n, ctx&) { radix_sort_hybrid<8, scatter_mode::buffered>(a, n); }),
+        in_place<T>("LSDRadixSortBufferedNT", [](T* a, size_t n, ctx&) { radix_sort_lsd_travis<8, scatter_mode::buffered_nt>(a, n); }),
+        in_place<T>("HybridRadixSortBufferedNT", [](T* a, size_t n, ctx&) { radix_sort_hybrid<8, scatter_mode::buffered_nt>(a, n); }),
+
+        // In-place sorts: compare their peak_mem with the O(n) buffer of the others
+        in_place<T>("InPlaceRadixSort", [](T* a, size_t n, ctx&) { radix_sort_inplace(a, n); }),
+        in_place<T>("InPlaceStableRadixSort", [](T* a, size_t n, ctx&) { radix_sort_inplace_stable(a, n); }),
+
+        in_place<T>("LSDRadixSortParallel", [](T* a, size_t n, ctx& c) { radix_sort_lsd_parallel(a, n, c.threads); }, true),
+        in_place<T>("HybridRadixSortParallel", [](T* a, size_t n, ctx& c) { radix_sort_hybrid_parallel(a, n, c.threads); }, true),
+        in_place<T>("InPlaceRadixSortParallel", [](T* a, size_t n, ctx& c) { radix_sort_inplace_parallel(a, n, c.threads); }, true),
+
+        // Argsort: what we have to do today to reorder the other columns of a table
+        { "StdStableSortIndices", [](const T* input, size_t n, ctx& c) {
+             std::iota(c.indices.begin(), c.indices.begin() + n, 0);
+             std::stable_sort(c.indices.begin(), c.indices.begin() + n, [input](uint32_t l, uint32_t r) { return radix_less()(input[l], input[r]); });
+         },
+            false, buffers::indices },
+        { "HybridRadixArgsort", [](const T* input, size_t n, ctx& c) {
+             argsort_scratch<T> scratch;
+             radix_argsort_hybrid(input, n, c.indices.data(), scratch);
+         },
+            false, buffers::indices },
+        { "InPlaceStableRadixArgsort", [](const T* input, size_t n, ctx& c) {
+             std::copy(input, input + n, c.values.begin());
+             std::iota(c.indices.begin(), c.indices.begin() + n, 0);
+             radix_sort_inplace_stable(c.values.data(), c.indices.data(), n);
+         },
+            false, buffers::values | buffers::indices },
+    };
+}
+
+// Selection, see radix_select.h: the median for nth_element, the 1000 smallest for partial_sort
+template <class T>
+std::vector<algorithm<T>> selection_algorithms()
+{
+    using ctx = sort_context<T>;
+    const size_t limitK = 1000;
+    return {
+        in_place<T>("StdNthElement", [](T* a, size_t n, ctx&) { std::nth_element(a, a + n / 2, a + n, radix_less()); }),
+        in_place<T>("RadixNthElement", [](T* a, size_t n, ctx&) { radix_nth_element(a, n, n / 2); }),
+        in_place<T>("StdPartialSort", [limitK](T* a, size_t n, ctx&) { std::partial_sort(a, a + std::min(n, limitK), a + n, radix_less()); }),
+        in_place<T>("RadixPartialSort", [limitK](T* a, size_t n, ctx&) { radix_partial_sort(a, n, std::min(n, limitK)); }),
+    };
+}
+
+// DISTINCT and GROUP BY key COUNT(*), see radix_unique.h, against a sort followed by std::unique
+// or a run-length pass: the keys go to context.values, the counts to context.counts
+template <class T>
+std::vector<algorithm<T>> unique_algorithms()
+{
+    using ctx = sort_context<T>;
+    auto equal = [](T l, T r) { return radix_key(l) == radix_key(r); };
+    return {
+        in_place<T>("StdSortUnique", [equal](T* a, size_t n, ctx&) {
+            std::sort(a, a + n, radix_less());
+            benchmark::DoNotOptimize(std::unique(a, a + n, equal));
+        }),
+        in_place<T>("HybridRadixSortUnique", [equal](T* a, size_t n, ctx& c) {
+            radix_sort_hybrid(a, n, c.scratch.data());
+            benchmark::DoNotOptimize(std::unique(a, a + n, equal));
+        }).with(buffers::scratch),
+        { "RadixSortUnique", [](const T* input, size_t n, ctx& c) {
+             benchmark::DoNotOptimize(radix_sort_unique(input, n, c.values.data(), c.scratch.data()));
+         },
+            false, buffers::values | buffers::unique_scratch },
+        in_place<T>("HybridRadixSortCount", [](T* a, size_t n, ctx& c) {
+            radix_sort_hybrid(a, n, c.scratch.data());
+            size_t runs = 0;
+            for (size_t i = 0; i < n;) {
+                size_t j = i + 1;
+                while (j < n && radix_key(a[j]) == radix_key(a[i]))
+                    ++j;
+                a[runs] = a[i];
+                c.counts[runs++] = j - i;
+                i = j;
+            }
+            benchmark::DoNotOptimize(runs);
+        }).with(buffers::scratch | buffers::counts),
+        { "RadixSortCount", [](const T* input, size_t n, ctx& c) {
+             benchmark::DoNotOptimize(radix_sort_count(input, n, c.values.data(), c.counts.data(), c.scratch.data()));
+         },
+            false, buffers::values | buffers::counts | buffers::unique_scratch },
+    };
+}
+
+// The sorts of the 128-bit keys, see radix_wide_keys.h: the ones which take any radix key
+template <class T>
+std::vector<algorithm<T>> wide_key_algorithms()
+{
+    using ctx = sort_context<T>;
+    return {
+        in_place<T>("StdStableSort", [](T* a, size_t n, ctx&) { std::stable_sort(a, a + n, radix_less()); }),
+        in_place<T>("MSDRadixSort", [](T* a, size_t n, ctx& c) { radix_sort_msd(a, n, c.scratch.data()); }).with(buffers::scratch),
+        in_place<T>("LSDRadixSort", [](T* a, size_t n, ctx& c) { radix_sort_lsd_travis(a, n, c.scratch.data()); }).with(buffers::scratch),
+        in_place<T>("HybridRadixSort", [](T* a, size_t n, ctx& c) { radix_sort_hybrid(a, n, c.scratch.data()); }).with(buffers::scratch),
+        // the MSD recursion over all the 16 bytes, without the 64-bit sort of the low words
+        in_place<T>("HybridRadixSortWide", [](T* a, size_t n, ctx& c) {
+            const auto varying = varying_bits(a, n);
+            if (varying != 0)
+                details::radix_msd_rec<8>(a, c.scratch.data(), 0, n, radix_digits<8>::top_level(varying), false);
+        }).with(buffers::scratch),
+        in_place<T>("RadixSort", [](T* a, size_t n, ctx& c) { radix_sort(a, n, c.scratch.data()); }).with(buffers::scratch),
+        { "StdStableSortIndices", [](const T* input, size_t n, ctx& c) {
+             std::iota(c.indices.begin(), c.indices.begin() + n, 0);
+             std::stable_sort(c.indices.begin(), c.indices.begin() + n, [input](uint32_t l, uint32_t r) { return radix_less()(input[l], input[r]); });
+         },
+            false, buffers::indices },
+        { "HybridRadixArgsort", [](const T* input, size_t n, ctx& c) {
+             argsort_scratch<T> scratch;
+             radix_argsort_hybrid(input, n, c.indices.data(), scratch);
+         },
+            false, buffers::indices },
+    };
+}
+
+// the algorithms of `all` which run on a single thread
+template <class T>
+std::vector<algorithm<T>> serial(const std::vector<algorithm<T>>& all)
+{
+    std::vector<algorithm<T>> selected;
+    std::copy_if(all.begin(), all.end(), std::back_inserter(selected), [](const algorithm<T>& algo) { return !algo.parallel; });
+    return selected;
+}
+
+template <class T>
+std::vector<algorithm<T>> parallel(const std::vector<algorithm<T>>& all)
+{
+    std::vector<algorithm<T>> selected;
+    std::copy_if(all.begin(), all.end(), std::back_inserter(selected), [](const algorithm<T>& algo) { return algo.parallel; });
+    return selected;
+}
+
+// the algorithms of `all` named in `names`, in that order
+template <class T>
+std::vector<algorithm<T>> select(const std::vector<algorithm<T>>& all, const std::vector<std::string>& names)
+{
+    std::vector<algorithm<T>> selected;
+    for (const auto& name : names) {
+        for (const auto& algo : all) {
+            if (algo.name == name)
+                selected.push_back(algo);
+        }
+    }
+    return selected;
+}
+
+/**
+ * The distributions of the keys, for any key type: the integers of the generators are cast to T,
+ * so the narrow types wrap around.
+ */
+namespace distributions {
+    // the integers [0, count) shuffled, unique as long as T holds count values
+    template <class T>
+    distribution<T> all_unique(const std::string& name = "allUnique")
+    {
+        return { name, [](std::vector<T>& vals, size_t count) {
+                    for (size_t i = 0; i < count; ++i)
+                        vals[i] = (T)i;
+                    std::random_device rd;
+                    std::mt19937 g(rd());
+                    std::shuffle(vals.begin(), vals.end(), g);
+                } };
+    }
+
+    // uniform random integers in [0, max]
+    template <class T>
+    distribution<T> uniform_up_to(const std::string& name, uint64_t max)
+    {
+        return { name, [max](std::vector<T>& vals, size_t count) {
+                    std::default_random_engine generator;
+                    std::uniform_int_distribution<uint64_t> distribution(0, max);
+                    for (size_t i = 0; i < count; ++i)
+                        vals[i] = (T)distribution(generator);
+                } };
+    }
+
+    // uniform random keys over the whole range of the integers, normally distributed floating point ones
+    template <class T>
+    distribution<T> uniform(const std::string& name = "uniform")
+    {
+        return { name, [](std::vector<T>& vals, size_t count) {
+                    std::default_random_engine generator;
+                    if constexpr (std::is_floating_point<T>::value) {
+                        std::normal_distribution<T> distribution(0.0, 1e6);
+                        for (size_t i = 0; i < count; ++i)
+                            vals[i] = distribution(generator);
+                    } else {
+                        using Wide = typename std::conditional<std::is_signed<T>::value, int64_t, uint64_t>::type;
+                        std::uniform_int_distribution<Wide> distribution(std::numeric_limits<T>::min(), std::numeric_limits<T>::max());
+                        for (size_t i = 0; i < count; ++i)
+                            vals[i] = (T)distribution(generator);
+                    }
+                } };
+    }
+
+    template <class T>
+    distribution<T> all_equal(const std::string& name = "allequal")
+    {
+        return { name, [](std::vector<T>& vals, size_t count) { std::fill_n(vals.begin(), count, (T)1000000007); } }; // a prime number
+    }
+
+    template <class T>
+    distribution<T> ascending(const std::string& name = "ascending")
+    {
+        return { name, [](std::vector<T>& vals, size_t count) {
+                    for (size_t i = 0; i < count; ++i)
+                        vals[i] = (T)i;
+                } };
+    }
+
+    template <class T>
+    distribution<T> descending(const std::string& name = "descending")
+    {
+        return { name, [](std::vector<T>& vals, size_t count) {
+                    for (size_t i = 0; i < count; ++i)
+                        vals[i] = (T)(count - i);
+                } };
+    }
+
+    // 6 random values
+    template <class T>
+    distribution<T> few_unique(const std::string& name = "fewunique")
+    {
+        return { name, [](std::vector<T>& vals, size_t count) {
+                    std::default_random_engine generator;
+                    std::uniform_int_distribution<int> distribution(0, 5);
+                    std::uniform_int_distribution<uint64_t> distributionVal;
+                    T fewUnique[6];
+                    for (int j = 0; j < 6; ++j)
+                        fewUnique[j] = (T)distributionVal(generator);
+                    for (size_t i = 0; i < count; ++i)
+                        vals[i] = fewUnique[distribution(generator)];
+                } };
+    }
+
+    // sorted uniform random keys, then count / 1000 of them swapped with the third one
+    template <class T>
+    distribution<T> almost_sorted(const std::string& name = "almostsorted")
+    {
+        return { name, [](std::vector<T>& vals, size_t count) {
+                    std::default_random_engine generator;
+                    std::uniform_int_distribution<uint64_t> distributionVal;
+                    for (size_t i = 0; i < count; ++i)
+                        vals[i] = (T)distributionVal(generator);
+                    std::sort(vals.begin(), vals.end(), radix_less());
+                    std::uniform_int_distribution<size_t> distributionInd(0, count - 1);
+                    for (size_t i = 0; i < count / 1000; ++i)
+                        std::swap(vals[2], vals[distributionInd(generator)]);
+                } };
+    }
+}
+
+namespace distributions {
+    // Money columns: log-normal amounts around 50.00 spanning cents to millions, 5% of them
+    // negative (refunds), as decimals of `scale` digits. decimal(18, 2) fits into 64 bits,
+    // decimal(38, 18), Spark's default, takes 70 to 90 bits.
+    inline distribution<decimal128> money(const std::string& name, unsigned scale)
+    {
+        return { name, [scale](std::vector<decimal128>& vals, size_t count) {
+                    std::default_random_engine generator;
+                    std::lognormal_distribution<double> amounts(std::log(5000.0), 2.0);
+                    std::bernoulli_distribution refund(0.05);
+                    radix_uint128_t unit = 1;
+                    for (unsigned d = 2; d < scale; ++d)
+                        unit *= 10;
+                    for (size_t i = 0; i < count; ++i) {
+                        const auto cents = (uint64_t)std::llround(std::min(amounts(generator), 1e12));
+                        radix_uint128_t value = cents * unit;
+                        if (refund(generator))
+                            value = -value; // two's complement
+                        vals[i] = { (uint64_t)value, (int64_t)(uint64_t)(value >> 64) };
+                    }
+                } };
+    }
+
+    // 128-bit hashes
+    inline distribution<uint128> hashes(const std::string& name = "hashes")
+    {
+        return { name, [](std::vector<uint128>& vals, size_t count) {
+                    std::mt19937_64 generator;
+                    for (size_t i = 0; i < count; ++i)
+                        vals[i] = { generator(), generator() };
+                } };
+    }
+}
+
+// the sizes [lo, hi] by step
+inline std::vector<int64_t> dense_sizes(int64_t lo, int64_t hi, int64_t step)
+{
+    std::vector<int64_t> sizes;
+    for (int64_t n = lo; n <= hi; n += step)
+        sizes.push_back(n);
+    return sizes;
+}
+
+// the powers of multiplier in [lo, hi] and hi, 1K to 1B by 8 covers the caches and the memory
+inline std::vector<int64_t> log_sizes(int64_t lo = 1 << 10, int64_t hi = 1 << 30, int multiplier = 8)
+{
+    return benchmark::CreateRange(lo, hi, multiplier);
+}
+
+// the sweep of the parallel algorithms
+inline std::vector<int64_t> thread_counts() { return benchmark::CreateRange(1, 32, 2); }
+
+template <class T>
+void run(benchmark::State& state, const algorithm<T>& algo, const distribution<T>& dist)
+{
+    const size_t n = state.range(0);
+    std::vector<T> input(n);
+    dist.generate(input, n);
+
+    sort_context<T> context;
+    context.threads = algo.parallel ? state.range(1) : 1;
+    if (algo.uses & buffers::values)
+        context.values.resize(n);
+    if (algo.uses & buffers::unique_scratch)
+        context.scratch.resize(radix_unique_scratch_size<T>(n));
+    else if (algo.uses & buffers::scratch)
+        context.scratch.resize(radix_sort_scratch_size<T>(n));
+    if (algo.uses & buffers::indices)
+        context.indices.resize(n);
+    if (algo.uses & buffers::counts)
+        context.counts.resize(n);
+    perf_counters::scope measure(state, n);
+    for (auto _ : state) {
+        algo.run(input.data(), n, context);
+        benchmark::DoNotOptimize(context.values.data());
+        benchmark::DoNotOptimize(context.indices.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+    state.SetBytesProcessed(state.iterations() * n * sizeof(T));
+}
+
+/**
+ * Registers every algorithm on every distribution for all the sizes, the parallel algorithms
+ * for all the sizes times thread_counts() in real time. The names are
+ * SortingBmk_<distribution>[_<key type>]/<algorithm>.
+ */
+template <class T>
+void register_sorts(const std::vector<distribution<T>>& dists, const std::vector<algorithm<T>>& algos,
+    const std::vector<int64_t>& sizes, benchmark::TimeUnit unit)
+{
+    const std::string typeSuffix = std::is_same<T, uint64_t>::value ? "" : "_" + key_type_name<T>();
+    for (const auto& dist : dists) {
+        for (const auto& algo : algos) {
+            const std::string name = "SortingBmk_" + dist.name + typeSuffix + "/" + algo.name;
+            auto* bmk = benchmark::RegisterBenchmark(name.c_str(), [algo, dist](benchmark::State& state) { run(state, algo, dist); })->Unit(unit);
+            if (algo.parallel)
+                bmk->ArgsProduct({ sizes, thread_counts() })->ArgNames({ "n", "threads" })->UseRealTime();
+            else
+                for (auto n : sizes)
+                    bmk->Arg(n);
+        }
+    }
+}
+}
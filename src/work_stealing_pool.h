@@ -0,0 +1,156 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Counts the unfinished tasks submitted to a work_stealing_pool, see work_stealing_pool::wait.
+struct task_group {
+    std::atomic<size_t> pending { 0 };
+};
+
+/**
+ * Minimal work-stealing thread pool used by the parallel sorts.
+ *
+ * Every thread owns a deque: it pushes and pops its own tasks at the back (depth-first, so the
+ * recursive sorts stay cache friendly) and steals from the front of the others when it runs
+ * dry (the oldest tasks are the largest subproblems). The pool starts numThreads - 1 workers,
+ * the thread which calls wait() is the last one, so only one external thread may use the pool.
+ * wait() executes tasks instead of blocking, which makes it safe to wait inside a task.
+ */
+class work_stealing_pool {
+public:
+    explicit work_stealing_pool(size_t numThreads)
+    {
+        numThreads = std::max<size_t>(1, numThreads);
+        for (size_t i = 0; i < numThreads; ++i) {
+            m_queues.emplace_back(new queue);
+        }
+        for (size_t i = 1; i < numThreads; ++i) {
+            m_threads.emplace_back([this, i] { worker_loop(i); });
+        }
+    }
+
+    ~work_stealing_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (auto& thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    work_stealing_pool(const work_stealing_pool&) = delete;
+    work_stealing_pool& operator=(const work_stealing_pool&) = delete;
+
+    size_t size() const { return m_queues.size(); }
+
+    template <class Fn>
+    void submit(task_group& group, Fn&& fn)
+    {
+        group.pending.fetch_add(1, std::memory_order_relaxed);
+        auto& q = *m_queues[current_index()];
+        {
+            std::lock_guard<std::mutex> lock(q.mutex);
+            q.tasks.emplace_back([&group, fn = std::forward<Fn>(fn)]() mutable {
+                fn();
+                group.pending.fetch_sub(1, std::memory_order_release);
+            });
+        }
+        {
+            // taken so that the notification can't slip in between a worker's check and its sleep
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_queued.fetch_add(1, std::memory_order_release);
+        }
+        m_wake.notify_one();
+    }
+
+    // runs the pending tasks (of any group) until all the tasks of `group` are done
+    void wait(task_group& group)
+    {
+        const size_t index = current_index();
+        while (group.pending.load(std::memory_order_acquire) != 0) {
+            if (!run_one(index)) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+private:
+    struct queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    // the thread which isn't a worker of this pool is the caller, it takes the slot 0
+    size_t current_index() const { return t_pool == this ? t_index : 0; }
+
+    bool run_one(size_t index)
+    {
+        std::function<void()> task;
+        if (!pop(index, task)) {
+            return false;
+        }
+        m_queued.fetch_sub(1, std::memory_order_relaxed);
+        task();
+        return true;
+    }
+
+    bool pop(size_t index, std::function<void()>& task)
+    {
+        {
+            auto& own = *m_queues[index];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (size_t i = 1; i < m_queues.size(); ++i) {
+            auto& victim = *m_queues[(index + i) % m_queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void worker_loop(size_t index)
+    {
+        t_pool = this;
+        t_index = index;
+        while (true) {
+            if (run_one(index)) {
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            m_wake.wait(lock, [this] { return m_stop || m_queued.load(std::memory_order_acquire) != 0; });
+            if (m_stop) {
+                return;
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<queue>> m_queues;
+    std::vector<std::thread> m_threads;
+    std::atomic<size_t> m_queued { 0 };
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+    bool m_stop = false;
+
+    inline static thread_local const work_stealing_pool* t_pool = nullptr;
+    inline static thread_local size_t t_index = 0;
+};